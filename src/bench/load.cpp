@@ -0,0 +1,219 @@
+#include <core/server/server.hpp>
+#include <core/metrics/metrics.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <charconv>
+#include <climits>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Closed-loop client results, latencies in histogram buckets.
+struct Client {
+	std::vector<uint64_t> buckets = std::vector<uint64_t>(CoreHistogram::buckets);
+	uint64_t requests = 0;
+	uint64_t errors   = 0;
+};
+
+/**
+ * Connect to loopback port, retrying while the server starts.
+ * @param port Server port.
+ * @return connection or -1.
+ */
+static int connectLoopback(const unsigned int port) {
+	for (int attempt = 0; attempt < 100; attempt++) {
+		int connection = socket(AF_INET, SOCK_STREAM, 0);
+
+		sockaddr_in address = {};
+		address.sin_family      = AF_INET;
+		address.sin_port        = htons(port);
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+		if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+			int conf = 1;
+			setsockopt(connection, IPPROTO_TCP, TCP_NODELAY, &conf, sizeof(conf));
+			return connection;
+		}
+
+		close(connection);
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+	}
+
+	return -1;
+}
+
+/**
+ * Read one response with Content-Length body.
+ * @param connection Client connection.
+ * @param buffer     Read buffer, keeps bytes of the next response.
+ * @return false on error or closed connection.
+ */
+static bool readResponse(const int connection, std::string &buffer) {
+	while (true) {
+		size_t end = buffer.find("\r\n\r\n");
+
+		if (end != std::string::npos) {
+			size_t length = 0;
+			size_t header = buffer.find("Content-Length: ");
+
+			if (header != std::string::npos && header < end) {
+				std::from_chars(buffer.data() + header + 16, buffer.data() + end, length);
+			}
+
+			if (buffer.length() >= end + 4 + length) {
+				buffer.erase(0, end + 4 + length);
+				return true;
+			}
+		}
+
+		char chunk[16384];
+		ssize_t size = recv(connection, chunk, sizeof(chunk), 0);
+		if (size <= 0) return false;
+
+		buffer.append(chunk, size);
+	}
+}
+
+/**
+ * Send requests one after another on one keep-alive connection until stopped.
+ * @param port      Server port.
+ * @param request   Raw request.
+ * @param measuring Wether warm-up is over.
+ * @param stopped   Wether run is over.
+ * @param client    Results.
+ */
+static void run(const unsigned int port, const std::string &request, const std::atomic<bool> &measuring, const std::atomic<bool> &stopped, Client &client) {
+	int connection = connectLoopback(port);
+	std::string buffer;
+
+	while (!stopped.load(std::memory_order_relaxed)) {
+		if (connection == -1) {
+			client.errors++;
+			connection = connectLoopback(port);
+			continue;
+		}
+
+		auto started = std::chrono::steady_clock::now();
+		bool answered = send(connection, request.data(), request.length(), MSG_NOSIGNAL) == static_cast<ssize_t>(request.length()) && readResponse(connection, buffer);
+		uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+
+		if (!answered) {
+			client.errors++;
+			close(connection);
+			buffer.clear();
+			connection = connectLoopback(port);
+			continue;
+		}
+
+		if (measuring.load(std::memory_order_relaxed)) {
+			client.buckets[CoreHistogram::index(elapsed)]++;
+			client.requests++;
+		}
+	}
+
+	if (connection != -1) close(connection);
+}
+
+/**
+ * Find latency below which quantile of requests finished.
+ * @param buckets  Merged histogram.
+ * @param total    Number of requests.
+ * @param quantile Quantile, for example 0.99.
+ * @return microseconds.
+ */
+static double percentile(const std::vector<uint64_t> &buckets, const uint64_t total, const double quantile) {
+	uint64_t rank = static_cast<uint64_t>(quantile * total);
+	uint64_t seen = 0;
+
+	for (size_t bucket = 0; bucket < buckets.size(); bucket++) {
+		seen += buckets[bucket];
+		if (seen > rank) return CoreHistogram::upper(bucket) / 1e3;
+	}
+
+	return 0;
+}
+
+/**
+ * Closed-loop load generator against a loopback CoreServer.
+ * Usage: load [connections] [seconds] [port] [workers] [pool threads] [io_uring]
+ */
+int main(int argc, char **argv) {
+	unsigned int connections = argc > 1 ? atoi(argv[1]) : 16;
+	unsigned int seconds     = argc > 2 ? atoi(argv[2]) : 5;
+	unsigned int port        = argc > 3 ? atoi(argv[3]) : 18181;
+	unsigned int workers     = argc > 4 ? atoi(argv[4]) : 1;
+	unsigned int threads     = argc > 5 ? atoi(argv[5]) : 0;
+	bool uring               = argc > 6 ? atoi(argv[6]) : false;
+
+	CoreRouter router;
+	CoreServer server(router, port, 1024, workers);
+	server.keepAlive(5, UINT_MAX);
+	server.get("/bench", std::string(128, 'x'));
+	server.get("/bench/:id", [](const Request &request, Response &response) {
+		response.type("application/json").send("{\"id\":\"" + std::string(request.getParam("id")) + "\"}");
+	});
+
+	if (threads > 0) {
+		server.pool(threads, 4096);
+	}
+
+	server.uring(uring);
+
+	std::thread([&server] { server.start(); }).detach();
+
+	const std::vector<std::string> requests = {
+		"GET /bench HTTP/1.1\r\nHost: localhost\r\nUser-Agent: core-load\r\nAccept: */*\r\n\r\n",
+		"GET /bench/42 HTTP/1.1\r\nHost: localhost\r\nUser-Agent: core-load\r\nAccept: */*\r\n\r\n"
+	};
+
+	for (const std::string &request : requests) {
+		std::atomic<bool> measuring = false;
+		std::atomic<bool> stopped   = false;
+		std::vector<Client> clients(connections);
+		std::vector<std::thread> running;
+
+		for (unsigned int i = 0; i < connections; i++) {
+			running.emplace_back(run, port, std::cref(request), std::cref(measuring), std::cref(stopped), std::ref(clients[i]));
+		}
+
+		// Warm up connections and caches before measuring.
+		std::this_thread::sleep_for(std::chrono::milliseconds(500));
+		measuring = true;
+		auto started = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(std::chrono::seconds(seconds));
+		stopped = true;
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+		for (auto &thread : running) thread.join();
+
+		Client total;
+		for (const Client &client : clients) {
+			total.requests += client.requests;
+			total.errors   += client.errors;
+			for (size_t bucket = 0; bucket < CoreHistogram::buckets; bucket++) total.buckets[bucket] += client.buckets[bucket];
+		}
+
+		std::string_view line(request.data(), request.find('\r'));
+		printf("%.*s, %u connections, %u s\n", static_cast<int>(line.length()), line.data(), connections, seconds);
+		printf("  throughput %12.0f req/s, %lu requests, %lu errors\n", total.requests / elapsed, total.requests, total.errors);
+		printf("  latency    p50 %8.1f us   p99 %8.1f us   p999 %8.1f us\n",
+			percentile(total.buckets, total.requests, 0.5),
+			percentile(total.buckets, total.requests, 0.99),
+			percentile(total.buckets, total.requests, 0.999)
+		);
+	}
+
+	// Server threads run forever, leave without destroying them.
+	fflush(stdout);
+	std::quick_exit(EXIT_SUCCESS);
+}
@@ -0,0 +1,261 @@
+#include <core/server/server.hpp>
+#include <core/router/trie.hpp>
+#include <core/data/data.hpp>
+#include <core/scan/scan.hpp>
+#include <core/limits/rate.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * Keep value alive so the compiler can not drop the measured work.
+ * @param value Value to keep.
+ */
+template <typename T>
+static void keep(const T &value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+/**
+ * Run function repeatedly and print time per call, after a warm-up run.
+ * @param name       Benchmark name.
+ * @param iterations Measured calls.
+ * @param function   Measured work.
+ */
+template <typename Function>
+static void bench(const char *name, const size_t iterations, Function function) {
+	for (size_t i = 0; i < iterations / 10; i++) function();
+
+	auto started = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < iterations; i++) function();
+	double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+
+	printf("%-40s %12.1f ns/op %14.0f op/s\n", name, elapsed / iterations, iterations / elapsed * 1e9);
+}
+
+/**
+ * Drain peer end of socket pair so responses never block.
+ * @param peer Reading end.
+ */
+static void drain(const int peer) {
+	static char sink[1 << 16];
+	while (recv(peer, sink, sizeof(sink), MSG_DONTWAIT) > 0);
+}
+
+/**
+ * Build url pattern of route number.
+ * @param route Route number.
+ */
+static std::string pattern(const size_t route) {
+	return "/api/v" + std::to_string(route % 4) + "/resource" + std::to_string(route) + (route % 3 == 0 ? "/:id" : "/list");
+}
+
+int main() {
+	const std::string request =
+		"GET /api/v1/resource333/list?page=2&size=50&sort=name%20asc HTTP/1.1\r\n"
+		"Host: localhost:8080\r\n"
+		"User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko)\r\n"
+		"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+		"Accept-Language: en-US,en;q=0.5\r\n"
+		"Accept-Encoding: gzip, deflate, br\r\n"
+		"Connection: keep-alive\r\n"
+		"Cookie: session=4f2a9c1e7b; theme=dark; visits=42\r\n"
+		"Cache-Control: max-age=0\r\n"
+		"\r\n";
+
+	printf("%-40s %15s %17s\n", "benchmark", "time", "throughput");
+
+	// Request line and header parsing.
+	bench("request parse", 1000000, [&] {
+		Request parsed(request);
+		keep(parsed.getMethod());
+	});
+
+	// Headers of browsers and traced services, mostly cookies and trace context.
+	std::string large = request.substr(0, request.length() - 2);
+	large.append("Cookie: ");
+	for (int i = 0; i < 16; i++) large.append("pref").append(std::to_string(i)).append("=a7d9f2c4e1b8a3f6d0c5b9e2a4f7c1d8; ");
+	large.append("csrf=1f8e2d7c6b5a\r\n");
+	large.append("traceparent: 00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01\r\n");
+	large.append("tracestate: vendor1=opaque1,vendor2=opaque2,vendor3=00f067aa0ba902b7\r\n");
+	large.append("baggage: user.id=4f2a9c1e7b,session.id=7b3c9d1e2f,deployment=canary-eu-west-1,tenant=acme-corporation\r\n");
+	large.append("X-Forwarded-For: 203.0.113.195, 70.41.3.18, 150.172.238.178\r\n\r\n");
+
+	std::string name = "request parse, " + std::to_string(large.length()) + " byte headers, ";
+	std::string_view detected = CoreScan::kernels();
+
+	for (const char *kernels : {"scalar", "sse4.2", "avx2"}) {
+		if (!CoreScan::use(kernels)) continue;
+
+		bench((name + kernels).c_str(), 500000, [&] {
+			Request parsed(large);
+			keep(parsed.getMethod());
+		});
+	}
+
+	CoreScan::use(detected);
+
+	bench("request header lookup", 1000000, [&] {
+		static const Request parsed(request);
+		keep(parsed.getHeader("accept-encoding"));
+	});
+
+	// Query pairs, successor of Request::readPairs.
+	bench("data pairs parse + typed get", 1000000, [] {
+		CoreData data;
+		data.pairs("page=2&size=50&sort=name%20asc&filter=a+b&active=true", '=', '&');
+		keep(data.get<int>("size"));
+	});
+
+	bench("request data typed get", 1000000, [&] {
+		Request parsed(request);
+		keep(parsed.getData<int>("page"));
+	});
+
+	// Route matching with many routes.
+	CoreTrie trie;
+	for (size_t route = 0; route < 1000; route++) trie.insert(pattern(route), route);
+
+	bench("trie find, 1000 routes, static", 1000000, [&] {
+		CoreTrie::Params params;
+		keep(trie.find("/api/v1/resource333/list", params));
+	});
+
+	bench("trie find, 1000 routes, param", 1000000, [&] {
+		CoreTrie::Params params;
+		keep(trie.find("/api/v3/resource999/1234", params));
+	});
+
+	// Rate limit checks of a flooding address and of many addresses, with a route limit.
+	CoreRateLimit rates;
+	rates.limit(100, 50);
+	rates.limit("/api/v1/:resource/list", 10, 5);
+
+	CoreLimits::Address flooding = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff, 203, 0, 113, 7};
+
+	bench("rate limit take, refused address", 1000000, [&] {
+		keep(rates.take(flooding, request));
+	});
+
+	uint32_t client = 0;
+	const std::string listing = "GET /api/v1/users/list HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+	bench("rate limit take, 100000 addresses + route", 1000000, [&] {
+		CoreLimits::Address address = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+		uint32_t host = client++ % 100000;
+		memcpy(address.data() + 12, &host, sizeof(host));
+		keep(rates.take(address, listing));
+	});
+
+	int pair[2];
+	socketpair(AF_UNIX, SOCK_STREAM, 0, pair);
+	int size = 1 << 20;
+	setsockopt(pair[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+
+	// Response serialization and vectored write.
+	const std::string content(512, 'x');
+
+	bench("response send, 512 byte body", 500000, [&] {
+		Response response(pair[0]);
+		response.keep_alive = true;
+		response.sendView(content);
+		drain(pair[1]);
+	});
+
+	bench("response send, headers + cookie", 500000, [&] {
+		Response response(pair[0]);
+		response.keep_alive = true;
+		response.header("Cache-Control", "no-cache").header("X-Request-Id", "abc123");
+		response.setCookie("session", "4f2a9c1e7b", "/", 3600);
+		response.sendView(content);
+		drain(pair[1]);
+	});
+
+	// Whole route pipeline: parse, match among 1000 routes, handler and write.
+	CoreRouter router;
+	CoreServer server(router, 0, 1);
+	for (size_t route = 0; route < 1000; route++) {
+		server.get(pattern(route), [](const Request &request, Response &response) {
+			response.sendView(request.getPath());
+		});
+	}
+
+	CoreOutput backlog;
+	bench("router respond, 1000 routes", 500000, [&] {
+		keep(router.respond(pair[0], request, true, &backlog));
+		drain(pair[1]);
+	});
+
+	// Handler that builds its content, then the same route served from the response cache.
+	server.get("/report", [](const Request&, Response &response) {
+		std::string report;
+		for (int row = 0; row < 100; row++) report.append("row ").append(std::to_string(row)).append(",ok\n");
+		response.type("text/csv").send(std::move(report));
+	});
+
+	const std::string report = "GET /report HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+	bench("router respond, uncached route", 500000, [&] {
+		keep(router.respond(pair[0], report, true, &backlog));
+		drain(pair[1]);
+	});
+
+	server.cache("/report", 60);
+
+	bench("router respond, cached route", 500000, [&] {
+		keep(router.respond(pair[0], report, true, &backlog));
+		drain(pair[1]);
+	});
+
+	// The same three layers composed into the route and registered for every route.
+	auto identify = [](const Request&, Response &response, auto &&next) {
+		response.header("X-Request-Id", "4bf92f3577b34da6");
+		next();
+	};
+
+	auto authorize = [](const Request &request, Response &response, auto &&next) {
+		if (request.getHeader("Authorization").empty()) {
+			response.status(401).send();
+			return;
+		}
+
+		next();
+	};
+
+	auto allow = [](const Request&, Response &response, auto &&next) {
+		response.header("Access-Control-Allow-Origin", "*");
+		next();
+	};
+
+	auto account = [](const Request&, Response &response) {
+		response.sendView("account");
+	};
+
+	server.get("/account", CoreChain(identify, authorize, allow, account));
+	server.get("/plain", account);
+
+	const std::string authorized = "GET /account HTTP/1.1\r\nHost: localhost\r\nAuthorization: Bearer 7b3c9d1e2f\r\n\r\n";
+	const std::string plain      = "GET /plain HTTP/1.1\r\nHost: localhost\r\nAuthorization: Bearer 7b3c9d1e2f\r\n\r\n";
+
+	bench("router respond, chain of 3 layers", 500000, [&] {
+		keep(router.respond(pair[0], authorized, true, &backlog));
+		drain(pair[1]);
+	});
+
+	server.use(identify).use(authorize).use(allow);
+
+	bench("router respond, middleware of 3 layers", 500000, [&] {
+		keep(router.respond(pair[0], plain, true, &backlog));
+		drain(pair[1]);
+	});
+
+	close(pair[0]);
+	close(pair[1]);
+	return 0;
+}
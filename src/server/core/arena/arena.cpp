@@ -0,0 +1,34 @@
+#include <core/arena/arena.hpp>
+
+/**
+ * Create arena on its inline block, growing from the heap when it is full.
+ */
+CoreArena::CoreArena():
+	resource(initial, sizeof(initial), std::pmr::new_delete_resource()) {
+}
+
+/**
+ * Get memory resource of arena for pmr containers.
+ */
+std::pmr::memory_resource *CoreArena::get() {
+	return &this -> resource;
+}
+
+/**
+ * Free every allocation, arena starts again from its inline block.
+ */
+void CoreArena::release() {
+	this -> resource.release();
+}
+
+/**
+ * Release arena at the end of scope.
+ * @param arena Arena to release.
+ */
+CoreArena::Scope::Scope(CoreArena &arena):
+	arena(arena) {
+}
+
+CoreArena::Scope::~Scope() {
+	this -> arena.release();
+}
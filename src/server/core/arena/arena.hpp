@@ -0,0 +1,42 @@
+#ifndef CORE_ARENA_HPP
+#define CORE_ARENA_HPP
+
+#include <cstddef>
+#include <memory_resource>
+
+/**
+ * Monotonic arena for allocations that live as long as one request.
+ * Allocations are bump-allocated from an inline block, larger requests
+ * grow it from the heap, and everything is freed at once on release.
+ */
+class CoreArena {
+	public:
+		static constexpr size_t block = 16384;
+
+		CoreArena();
+		CoreArena(const CoreArena&) = delete;
+		CoreArena &operator=(const CoreArena&) = delete;
+
+		std::pmr::memory_resource *get();
+		void release();
+
+		/**
+		 * Release arena when scope ends, declare it before objects using the arena.
+		 */
+		class Scope {
+			public:
+				Scope(CoreArena &arena);
+				Scope(const Scope&) = delete;
+				Scope &operator=(const Scope&) = delete;
+				~Scope();
+
+			private:
+				CoreArena &arena;
+		};
+
+	private:
+		alignas(std::max_align_t) std::byte initial[block];
+		std::pmr::monotonic_buffer_resource resource;
+};
+
+#endif
@@ -0,0 +1,213 @@
+#include <core/body/body.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <charconv>
+
+/**
+ * Remove temporary file.
+ */
+CoreBody::~CoreBody() {
+	this -> reset(0, "");
+}
+
+/**
+ * Prepare for a new body, previous temporary file is removed.
+ * @param spill     Body size kept in memory before it goes to a temporary file.
+ * @param directory Directory of temporary files.
+ * @param consumer  Route chunk consumer, body is not kept when set.
+ * @param request   Request passed to the consumer.
+ */
+void CoreBody::reset(const size_t spill, const std::string &directory, const Consumer *consumer, const Request *request) {
+	if (this -> file != -1) {
+		::close(this -> file);
+		unlink(this -> file_path.c_str());
+		this -> file = -1;
+		this -> file_path.clear();
+	}
+
+	this -> memory.clear();
+	this -> total     = 0;
+	this -> spill     = spill;
+	this -> directory = directory;
+	this -> consumer  = consumer;
+	this -> request   = request;
+}
+
+/**
+ * Add received chunk of body.
+ * @param chunk Body bytes.
+ * @return false when consumer rejected the body or temporary file failed.
+ */
+bool CoreBody::append(std::string_view chunk) {
+	this -> total += chunk.length();
+
+	if (this -> consumer) {
+		return (*this -> consumer)(*this -> request, chunk);
+	}
+
+	if (this -> file != -1) {
+		return this -> write(chunk);
+	}
+
+	if (this -> memory.length() + chunk.length() <= this -> spill) {
+		this -> memory.append(chunk);
+		return true;
+	}
+
+	return this -> spillMemory() && this -> write(chunk);
+}
+
+/**
+ * Move body from memory to a new temporary file.
+ * @return false when file could not be created.
+ */
+bool CoreBody::spillMemory() {
+	this -> file_path = this -> directory + "/core-body-XXXXXX";
+	this -> file = mkostemp(this -> file_path.data(), O_CLOEXEC);
+
+	if (this -> file == -1) {
+		this -> file_path.clear();
+		return false;
+	}
+
+	bool written = this -> write(this -> memory);
+	this -> memory.clear();
+	this -> memory.shrink_to_fit();
+	return written;
+}
+
+/**
+ * Write chunk to the temporary file.
+ * @param chunk Body bytes.
+ * @return false on write failure.
+ */
+bool CoreBody::write(std::string_view chunk) {
+	while (!chunk.empty()) {
+		ssize_t size = ::write(this -> file, chunk.data(), chunk.length());
+
+		if (size == -1) {
+			if (errno == EINTR) continue;
+			return false;
+		}
+
+		chunk.remove_prefix(size);
+	}
+
+	return true;
+}
+
+/**
+ * Get body kept in memory, empty when spilled or consumed.
+ */
+std::string_view CoreBody::view() const {
+	return this -> memory;
+}
+
+/**
+ * Get temporary file path of spilled body, empty when kept in memory.
+ */
+const std::string &CoreBody::path() const {
+	return this -> file_path;
+}
+
+/**
+ * Get number of body bytes received.
+ */
+size_t CoreBody::size() const {
+	return this -> total;
+}
+
+/**
+ * Check wether body went to a temporary file.
+ */
+bool CoreBody::spilled() const {
+	return this -> file != -1;
+}
+
+/**
+ * Prepare for a new chunked body.
+ */
+void CoreChunked::reset() {
+	this -> state     = State::Size;
+	this -> remaining = 0;
+}
+
+/**
+ * Decode as much input as possible into body.
+ * @param input Received bytes after headers or previous decode.
+ * @param body  Body receiving decoded chunks.
+ * @return number of input bytes used.
+ */
+size_t CoreChunked::decode(std::string_view input, CoreBody &body) {
+	size_t position = 0;
+
+	while (position < input.length() && this -> state != State::Done && this -> state != State::Failed) {
+		// Chunk data.
+		if (this -> state == State::Data) {
+			size_t take = std::min(this -> remaining, input.length() - position);
+
+			if (!body.append(input.substr(position, take))) {
+				this -> state = State::Failed;
+				break;
+			}
+
+			position += take;
+			this -> remaining -= take;
+			if (this -> remaining == 0) this -> state = State::DataEnd;
+			continue;
+		}
+
+		// Every other state reads one line.
+		size_t end = input.find('\n', position);
+		if (end == std::string_view::npos) {
+			if (input.length() - position > line_max) this -> state = State::Failed;
+			break;
+		}
+
+		std::string_view line = input.substr(position, end - position);
+		if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+		position = end + 1;
+
+		// Chunk size in hex, extensions are ignored.
+		if (this -> state == State::Size) {
+			line = line.substr(0, line.find(';'));
+			while (!line.empty() && (line.back() == ' ' || line.back() == '\t')) line.remove_suffix(1);
+
+			auto parsed = std::from_chars(line.data(), line.data() + line.length(), this -> remaining, 16);
+			if (line.empty() || parsed.ptr != line.data() + line.length() || parsed.ec != std::errc()) {
+				this -> state = State::Failed;
+				break;
+			}
+
+			this -> state = this -> remaining == 0 ? State::Trailer : State::Data;
+
+		// Chunk data ends with an empty line.
+		} else if (this -> state == State::DataEnd) {
+			this -> state = line.empty() ? State::Size : State::Failed;
+
+		// Trailer fields are ignored until the empty line.
+		} else if (line.empty()) {
+			this -> state = State::Done;
+		}
+	}
+
+	return position;
+}
+
+/**
+ * Check wether the last chunk and trailer were decoded.
+ */
+bool CoreChunked::isDone() const {
+	return this -> state == State::Done;
+}
+
+/**
+ * Check wether body is malformed or was rejected.
+ */
+bool CoreChunked::isFailed() const {
+	return this -> state == State::Failed;
+}
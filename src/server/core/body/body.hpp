@@ -0,0 +1,68 @@
+#ifndef CORE_BODY_HPP
+#define CORE_BODY_HPP
+
+#include <core/headers/request.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <string_view>
+
+/**
+ * Request body received in chunks. Chunks go to a consumer when the route
+ * registered one, otherwise to memory until the spill size is reached
+ * and to an unlinked-on-reset temporary file after that.
+ */
+class CoreBody {
+	public:
+		using Consumer = std::function<bool(const Request&, std::string_view)>;
+
+		CoreBody() = default;
+		CoreBody(const CoreBody&) = delete;
+		CoreBody &operator=(const CoreBody&) = delete;
+		~CoreBody();
+
+		void reset(const size_t spill, const std::string &directory, const Consumer *consumer = nullptr, const Request *request = nullptr);
+		bool append(std::string_view chunk);
+
+		std::string_view view() const;
+		const std::string &path() const;
+		size_t size() const;
+		bool spilled() const;
+
+	private:
+		std::string memory;
+		std::string file_path;
+		std::string directory;
+		int file     = -1;
+		size_t total = 0;
+		size_t spill = 0;
+
+		const Consumer *consumer = nullptr;
+		const Request *request   = nullptr;
+
+		bool spillMemory();
+		bool write(std::string_view chunk);
+};
+
+/**
+ * Incremental decoder of Transfer-Encoding: chunked request bodies.
+ */
+class CoreChunked {
+	public:
+		void reset();
+		size_t decode(std::string_view input, CoreBody &body);
+
+		bool isDone() const;
+		bool isFailed() const;
+
+	private:
+		enum class State { Size, Data, DataEnd, Trailer, Done, Failed };
+
+		static constexpr size_t line_max = 4096;
+
+		State state      = State::Size;
+		size_t remaining = 0;
+};
+
+#endif
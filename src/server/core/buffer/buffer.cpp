@@ -0,0 +1,210 @@
+#include <core/buffer/buffer.hpp>
+
+#include <strings.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <charconv>
+
+/**
+ * Create receive buffer.
+ * @param block Minimum free space to have available for every read.
+ */
+CoreBuffer::CoreBuffer(const size_t block):
+	block(block) {
+}
+
+/**
+ * Read one block from connection into buffer.
+ * @param connection Client connection.
+ * @return bytes read, 0 on connection close and -1 on error (see errno).
+ */
+ssize_t CoreBuffer::receive(const int connection) {
+	this -> reserve(this -> block);
+
+	ssize_t size = recv(connection, this -> data.data() + this -> end, this -> data.size() - this -> end, 0);
+	if (size > 0) {
+		this -> end += size;
+	}
+
+	return size;
+}
+
+/**
+ * Append data received elsewhere.
+ * @param data Received bytes.
+ */
+void CoreBuffer::append(std::string_view data) {
+	this -> reserve(data.length());
+	std::copy(data.begin(), data.end(), this -> data.begin() + this -> end);
+	this -> end += data.length();
+}
+
+/**
+ * Make sure there is at least length bytes of free space after buffered data.
+ * Consumed space at the front is reused before the buffer grows.
+ * @param length Free space required.
+ */
+void CoreBuffer::reserve(const size_t length) {
+	if (this -> data.size() - this -> end >= length) return;
+
+	// Move unread data to the front.
+	if (this -> start > 0) {
+		std::copy(this -> data.begin() + this -> start, this -> data.begin() + this -> end, this -> data.begin());
+		this -> end  -= this -> start;
+		this -> start = 0;
+	}
+
+	// Grow when still not enough space.
+	if (this -> data.size() - this -> end < length) {
+		this -> data.resize(std::max(this -> data.size() * 2, this -> end + length));
+	}
+}
+
+/**
+ * Parse Content-Length value, the whole value without surrounding whitespace has to be digits.
+ * @param value  Header value.
+ * @param length Receives the length.
+ * @return false when value is not a length.
+ */
+static bool parseLength(std::string_view value, size_t &length) {
+	size_t first = value.find_first_not_of(" \t");
+	size_t last  = value.find_last_not_of(" \t");
+	if (first == std::string_view::npos) return false;
+
+	value = value.substr(first, last - first + 1);
+	if (value.find_first_not_of("0123456789") != std::string_view::npos) return false;
+
+	auto [end, error] = std::from_chars(value.data(), value.data() + value.length(), length);
+	return error == std::errc() && end == value.data() + value.length();
+}
+
+/**
+ * Read framing of the first request in buffer from its header lines.
+ * Malformed or conflicting Content-Length values and Content-Length next to
+ * chunked encoding make the framing invalid, Request reads the first value
+ * and the next pipelined request would start elsewhere otherwise.
+ * @param frame Header length, Content-Length and chunked transfer encoding.
+ * @return false while headers are incomplete.
+ */
+bool CoreBuffer::frame(CoreFrame &frame) const {
+	std::string_view buffer = this -> view();
+
+	// Head ends with an empty line, lines end with CRLF or a bare LF as Request reads them.
+	size_t end  = std::string_view::npos;
+	size_t line = buffer.find('\n');
+
+	while (line != std::string_view::npos) {
+		size_t next = line + 1;
+		if (next < buffer.length() && buffer[next] == '\r') next++;
+
+		if (next < buffer.length() && buffer[next] == '\n') {
+			end = next + 1;
+			break;
+		}
+
+		line = buffer.find('\n', line + 1);
+	}
+
+	if (end == std::string_view::npos) return false;
+
+	frame = CoreFrame();
+	frame.head = end;
+
+	size_t start = buffer.find('\n') + 1;
+	bool sized   = false;
+
+	// Find Content-Length and Transfer-Encoding from header lines.
+	while (start < end) {
+		static const char length[]   = "content-length:";
+		static const char encoding[] = "transfer-encoding:";
+
+		line = buffer.find('\n', start);
+		std::string_view field = buffer.substr(start, line - start);
+		if (field.ends_with('\r')) field.remove_suffix(1);
+		start = line + 1;
+
+		if (field.length() >= sizeof(length) - 1 && strncasecmp(field.data(), length, sizeof(length) - 1) == 0) {
+			size_t value = 0;
+			bool valid = parseLength(field.substr(sizeof(length) - 1), value);
+
+			// Repeated header has to repeat the same length.
+			frame.invalid = frame.invalid || !valid || (sized && value != frame.length);
+			frame.length  = value;
+			sized = true;
+
+		} else if (field.length() >= sizeof(encoding) - 1 && strncasecmp(field.data(), encoding, sizeof(encoding) - 1) == 0) {
+			std::string_view value = field.substr(sizeof(encoding) - 1);
+
+			for (size_t i = 0; i + 7 <= value.length() && !frame.chunked; i++) {
+				frame.chunked = strncasecmp(value.data() + i, "chunked", 7) == 0;
+			}
+		}
+	}
+
+	frame.invalid = frame.invalid || (frame.chunked && sized);
+
+	// Body of invalid framing is never read, the connection closes after 400.
+	if (frame.chunked || frame.invalid) {
+		frame.length = 0;
+	}
+
+	if (frame.invalid) {
+		frame.chunked = false;
+	}
+
+	return true;
+}
+
+/**
+ * Get length of the first complete request in buffer, using the end of
+ * headers and Content-Length header.
+ * @return request length with body or 0 when request is incomplete.
+ */
+size_t CoreBuffer::requestLength() const {
+	CoreFrame frame;
+	if (!this -> frame(frame)) return 0;
+
+	size_t total = frame.head + frame.length;
+	return this -> size() >= total ? total : 0;
+}
+
+/**
+ * Get unread buffered data.
+ */
+std::string_view CoreBuffer::view() const {
+	return std::string_view(this -> data.data() + this -> start, this -> end - this -> start);
+}
+
+/**
+ * Get unread buffered data size.
+ */
+size_t CoreBuffer::size() const {
+	return this -> end - this -> start;
+}
+
+/**
+ * Check wether buffer has unread data.
+ */
+bool CoreBuffer::empty() const {
+	return this -> start == this -> end;
+}
+
+/**
+ * Mark data at the front as read.
+ * @param length Number of bytes read.
+ */
+void CoreBuffer::consume(const size_t length) {
+	this -> start += std::min(length, this -> size());
+
+	// Everything read, rewind without moving data.
+	if (this -> start == this -> end) {
+		this -> start = this -> end = 0;
+	}
+}
+
+/**
+ * Drop all buffered data, memory is kept for reuse.
+ */
+void CoreBuffer::clear() {
+	this -> start = this -> end = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef CORE_BUFFER_HPP
+#define CORE_BUFFER_HPP
+
+#include <sys/types.h>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+/**
+ * Framing of a request read from its headers. Invalid framing has a body
+ * length other parsers could read differently, the request gets 400.
+ */
+struct CoreFrame {
+	size_t head   = 0;
+	size_t length = 0;
+	bool chunked  = false;
+	bool invalid  = false;
+};
+
+/**
+ * Reusable receive buffer that reads connection input in large blocks
+ * and frames complete HTTP requests.
+ */
+class CoreBuffer {
+	public:
+		CoreBuffer(const size_t block = 16384);
+
+		ssize_t receive(const int connection);
+		void append(std::string_view data);
+
+		bool frame(CoreFrame &frame) const;
+		size_t requestLength() const;
+		std::string_view view() const;
+		size_t size() const;
+		bool empty() const;
+
+		void consume(const size_t length);
+		void clear();
+
+	private:
+		const size_t block;
+		std::vector<char> data;
+		size_t start = 0;
+		size_t end   = 0;
+
+		void reserve(const size_t length);
+};
+
+#endif
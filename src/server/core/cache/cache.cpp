@@ -0,0 +1,188 @@
+#include <core/cache/cache.hpp>
+
+#include <functional>
+
+/**
+ * Create cache.
+ * @param memory Memory limit of cached responses, split evenly between shards.
+ */
+CoreCache::CoreCache(const size_t memory):
+	shard_size(memory / shard_count) {
+}
+
+/**
+ * Get cached response. On a miss the first request gets an active fill and
+ * runs the handler, concurrent requests for the key wait until it finishes.
+ * Requests that may not wait run the handler without filling the key.
+ * @param key  Cache key.
+ * @param fill Becomes active when request has to fill the key.
+ * @param wait Wether caller may block on a concurrent miss, reactor threads may not.
+ * @return cached response, nullptr when handler has to run.
+ */
+std::shared_ptr<const CoreCache::Entry> CoreCache::get(const std::string &key, Fill &fill, const bool wait) {
+	Shard &shard = this -> shard(key);
+	std::shared_future<std::shared_ptr<const Entry>> waiting;
+
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto found = shard.entries.find(key);
+
+		if (found != shard.entries.end()) {
+			if (found -> second.entry -> expires > std::chrono::steady_clock::now()) {
+				shard.used.splice(shard.used.begin(), shard.used, found -> second.used);
+				return found -> second.entry;
+			}
+
+			this -> erase(shard, found);
+		}
+
+		auto pending = shard.pending.find(key);
+
+		// First miss fills the key.
+		if (pending == shard.pending.end()) {
+			fill.cache = this;
+			fill.key   = key;
+			shard.pending.emplace(key, fill.promise.get_future().share());
+			return nullptr;
+		}
+
+		if (!wait) return nullptr;
+
+		waiting = pending -> second;
+	}
+
+	// Another request runs the handler, dropped fills and slow handlers leave us on our own.
+	if (waiting.wait_for(coalesce_timeout) != std::future_status::ready) return nullptr;
+	return waiting.get();
+}
+
+/**
+ * Get fresh cached response without filling the key on a miss.
+ * @param key Cache key.
+ * @return cached response, nullptr on a miss.
+ */
+std::shared_ptr<const CoreCache::Entry> CoreCache::peek(const std::string &key) {
+	Shard &shard = this -> shard(key);
+	std::lock_guard<std::mutex> lock(shard.mutex);
+
+	auto found = shard.entries.find(key);
+	if (found == shard.entries.end() || found -> second.entry -> expires <= std::chrono::steady_clock::now()) return nullptr;
+
+	shard.used.splice(shard.used.begin(), shard.used, found -> second.used);
+	return found -> second.entry;
+}
+
+/**
+ * Build cache key from route method, path, varying query values and headers and content encoding.
+ * @param method   Route method.
+ * @param request  Request.
+ * @param policy   Route cache policy.
+ * @param encoding Negotiated content encoding, empty when content is not compressed.
+ * @return key.
+ */
+std::string CoreCache::key(std::string_view method, const Request &request, const Policy &policy, std::string_view encoding) {
+	std::string key;
+	key.append(method).append(" ").append(encoding).append(" ").append(request.getPath());
+
+	// Values are length prefixed, decoded query values may contain any byte.
+	auto append = [&key](std::string_view value) {
+		key.append(" ").append(std::to_string(value.length())).append(":").append(value);
+	};
+
+	for (const std::string &name : policy.query) {
+		append(request.getData(name));
+	}
+
+	for (const std::string &name : policy.headers) {
+		append(request.getHeader(name));
+	}
+
+	return key;
+}
+
+/**
+ * Get shard of key.
+ * @param key Cache key.
+ */
+CoreCache::Shard &CoreCache::shard(const std::string &key) {
+	return this -> shards[std::hash<std::string>()(key) % shard_count];
+}
+
+/**
+ * Store entry as most recently used, evicting least recently used entries over the shard limit.
+ * @param shard Locked shard.
+ * @param key   Cache key.
+ * @param entry Serialized response.
+ */
+void CoreCache::insert(Shard &shard, const std::string &key, std::shared_ptr<const Entry> entry) {
+	size_t size = key.length() + entry -> bytes.length();
+	if (size > this -> shard_size) return;
+
+	auto found = shard.entries.find(key);
+	if (found != shard.entries.end()) {
+		this -> erase(shard, found);
+	}
+
+	shard.used.push_front(key);
+	shard.entries[key] = {std::move(entry), shard.used.begin()};
+	shard.size += size;
+
+	while (shard.size > this -> shard_size && !shard.used.empty()) {
+		this -> erase(shard, shard.entries.find(shard.used.back()));
+	}
+}
+
+/**
+ * Remove entry from shard.
+ * @param shard Locked shard.
+ * @param found Entry.
+ */
+void CoreCache::erase(Shard &shard, std::unordered_map<std::string, Stored>::iterator found) {
+	shard.size -= found -> first.length() + found -> second.entry -> bytes.length();
+	shard.used.erase(found -> second.used);
+	shard.entries.erase(found);
+}
+
+/**
+ * Check wether request fills the key.
+ */
+bool CoreCache::Fill::isActive() const {
+	return this -> cache != nullptr;
+}
+
+/**
+ * Store response of the handler and hand it to the waiting requests.
+ * @param entry Serialized response.
+ * @param ttl   Time entry stays fresh.
+ */
+void CoreCache::Fill::store(Entry entry, const std::chrono::seconds ttl) {
+	if (!this -> cache) return;
+
+	entry.expires = std::chrono::steady_clock::now() + ttl;
+	auto stored = std::make_shared<const Entry>(std::move(entry));
+
+	Shard &shard = this -> cache -> shard(this -> key);
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		this -> cache -> insert(shard, this -> key, stored);
+		shard.pending.erase(this -> key);
+	}
+
+	this -> promise.set_value(std::move(stored));
+	this -> cache = nullptr;
+}
+
+/**
+ * Release waiting requests when response was not stored, they run the handler themselves.
+ */
+CoreCache::Fill::~Fill() {
+	if (!this -> cache) return;
+
+	Shard &shard = this -> cache -> shard(this -> key);
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.pending.erase(this -> key);
+	}
+
+	this -> promise.set_value(nullptr);
+}
@@ -0,0 +1,96 @@
+#ifndef CORE_CACHE_HPP
+#define CORE_CACHE_HPP
+
+#include <core/headers/request.hpp>
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Cache of serialized responses of idempotent GET routes. Entries expire after
+ * the TTL of their route, lock-striped shards evict least recently used entries
+ * over their share of the memory limit. Concurrent misses of one key are
+ * coalesced when callers may block, the first request runs the handler and
+ * the rest wait for it.
+ */
+class CoreCache {
+	public:
+		// Serialized response, headers without Connection and content after them.
+		// Route is the index of the route that responded, for hits found before routing.
+		struct Entry {
+			std::string bytes;
+			size_t head  = 0;
+			size_t route = 0;
+			std::chrono::steady_clock::time_point expires;
+		};
+
+		// Cached route, its response varies by the listed query values and headers.
+		struct Policy {
+			std::chrono::seconds ttl;
+			std::vector<std::string> query;
+			std::vector<std::string> headers;
+		};
+
+		// Miss the request has to fill, waiting requests are released once it is stored or dropped.
+		class Fill {
+			public:
+				Fill() = default;
+				Fill(const Fill&) = delete;
+				Fill &operator=(const Fill&) = delete;
+				~Fill();
+
+				bool isActive() const;
+				void store(Entry entry, const std::chrono::seconds ttl);
+
+			private:
+				CoreCache *cache = nullptr;
+				std::string key;
+				std::promise<std::shared_ptr<const Entry>> promise;
+
+			friend class CoreCache;
+		};
+
+		CoreCache(const size_t memory = 67108864);
+
+		std::shared_ptr<const Entry> get(const std::string &key, Fill &fill, const bool wait = true);
+		std::shared_ptr<const Entry> peek(const std::string &key);
+
+		static std::string key(std::string_view method, const Request &request, const Policy &policy, std::string_view encoding);
+
+	private:
+		static constexpr size_t shard_count = 16;
+
+		// Requests wait this long for a concurrent miss before running the handler themselves.
+		static constexpr std::chrono::seconds coalesce_timeout = std::chrono::seconds(10);
+
+		struct Stored {
+			std::shared_ptr<const Entry> entry;
+			std::list<std::string>::iterator used;
+		};
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::list<std::string> used;
+			std::unordered_map<std::string, Stored> entries;
+			std::unordered_map<std::string, std::shared_future<std::shared_ptr<const Entry>>> pending;
+			size_t size = 0;
+		};
+
+		const size_t shard_size;
+		std::array<Shard, shard_count> shards;
+
+		Shard &shard(const std::string &key);
+		void insert(Shard &shard, const std::string &key, std::shared_ptr<const Entry> entry);
+		void erase(Shard &shard, std::unordered_map<std::string, Stored>::iterator found);
+};
+
+#endif
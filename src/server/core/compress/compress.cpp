@@ -0,0 +1,197 @@
+#include <core/compress/compress.hpp>
+
+#include <zlib.h>
+#include <strings.h>
+#include <stdexcept>
+
+/**
+ * Reusable deflate streams of one thread, initialising zlib per response is expensive.
+ */
+struct Streams {
+	z_stream gzip    = {};
+	z_stream deflate = {};
+	int level        = -2;
+
+	~Streams() {
+		if (this -> level != -2) {
+			deflateEnd(&this -> gzip);
+			deflateEnd(&this -> deflate);
+		}
+	}
+
+	/**
+	 * Get stream for encoding, reset and ready for new content.
+	 * @param encoding "gzip" or "deflate".
+	 * @param level    Compression level.
+	 * @return zlib stream.
+	 */
+	z_stream &get(std::string_view encoding, const int level) {
+		if (this -> level != level) {
+			if (this -> level != -2) {
+				deflateEnd(&this -> gzip);
+				deflateEnd(&this -> deflate);
+			}
+
+			// Window bits over 15 write gzip wrapper instead of zlib wrapper.
+			if (
+				deflateInit2(&this -> gzip,    level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK ||
+				deflateInit2(&this -> deflate, level, Z_DEFLATED, 15,      8, Z_DEFAULT_STRATEGY) != Z_OK
+			) {
+				throw std::runtime_error("Error: Unable to initialise compression.");
+			}
+
+			this -> level = level;
+		}
+
+		z_stream &stream = encoding == "gzip" ? this -> gzip : this -> deflate;
+		deflateReset(&stream);
+		return stream;
+	}
+};
+
+/**
+ * Configure compression.
+ * @param minimum    Smallest content length worth compressing.
+ * @param types      Content types that are compressed.
+ * @param level      zlib compression level.
+ * @param cache_size Memory limit of cached compressed content.
+ */
+CoreCompress::CoreCompress(const size_t minimum, const std::vector<std::string> &types, const int level, const size_t cache_size):
+	minimum(minimum), types(types), level(level), cache_size(cache_size) {
+}
+
+/**
+ * Check wether content of type and length is compressed.
+ * @param content_type Response content type, parameters are ignored.
+ * @param length       Content length.
+ * @return true when content should be compressed.
+ */
+bool CoreCompress::allows(std::string_view content_type, const size_t length) const {
+	if (length < this -> minimum) return false;
+
+	content_type = content_type.substr(0, content_type.find(';'));
+	while (!content_type.empty() && content_type.back() == ' ') content_type.remove_suffix(1);
+
+	for (const std::string &type : this -> types) {
+		if (type.length() == content_type.length() && strncasecmp(type.data(), content_type.data(), type.length()) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Pick encoding accepted by client, gzip is preferred.
+ * @param accept_encoding Accept-Encoding request header.
+ * @return "gzip", "deflate" or empty view when nothing is accepted.
+ */
+std::string_view CoreCompress::negotiate(std::string_view accept_encoding) const {
+	if (accepts(accept_encoding, "gzip"))    return "gzip";
+	if (accepts(accept_encoding, "deflate")) return "deflate";
+	return std::string_view();
+}
+
+/**
+ * Compress content.
+ * @param content  Content to compress.
+ * @param encoding "gzip" or "deflate".
+ * @return compressed content.
+ */
+std::string CoreCompress::compress(std::string_view content, std::string_view encoding) const {
+	static thread_local Streams streams;
+	z_stream &stream = streams.get(encoding, this -> level);
+
+	std::string compressed;
+	compressed.resize(deflateBound(&stream, content.length()));
+
+	stream.next_in   = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+	stream.avail_in  = content.length();
+	stream.next_out  = reinterpret_cast<Bytef*>(compressed.data());
+	stream.avail_out = compressed.length();
+
+	// Bound is large enough for a single pass.
+	if (deflate(&stream, Z_FINISH) != Z_STREAM_END) {
+		throw std::runtime_error("Error: Unable to compress content.");
+	}
+
+	compressed.resize(stream.total_out);
+	return compressed;
+}
+
+/**
+ * Get compressed content from cache, compressing it on first use.
+ * @param key      Cache key, the same key always has the same content.
+ * @param content  Content to compress on cache miss.
+ * @param encoding "gzip" or "deflate".
+ * @return compressed content.
+ */
+std::shared_ptr<const std::string> CoreCompress::cached(const std::string &key, std::string_view content, std::string_view encoding) {
+	std::string entry_key = std::string(encoding) + ":" + key;
+
+	{
+		std::lock_guard<std::mutex> lock(this -> mutex);
+		auto found = this -> cache.find(entry_key);
+
+		if (found != this -> cache.end()) {
+			this -> used.splice(this -> used.begin(), this -> used, found -> second.used);
+			return found -> second.content;
+		}
+	}
+
+	// Compress outside of the lock, concurrent misses may compress twice.
+	auto compressed = std::make_shared<const std::string>(this -> compress(content, encoding));
+
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	if (this -> cache.contains(entry_key)) return compressed;
+
+	this -> used.push_front(entry_key);
+	this -> cache[entry_key] = {compressed, this -> used.begin()};
+	this -> cached_size += compressed -> length();
+
+	// Evict least recently used content over the memory limit.
+	while (this -> cached_size > this -> cache_size && !this -> used.empty()) {
+		auto evicted = this -> cache.find(this -> used.back());
+		this -> cached_size -= evicted -> second.content -> length();
+		this -> cache.erase(evicted);
+		this -> used.pop_back();
+	}
+
+	return compressed;
+}
+
+/**
+ * Check wether Accept-Encoding header accepts encoding, "q=0" rejects it.
+ * @param accept_encoding Accept-Encoding request header.
+ * @param encoding        Encoding to look for.
+ * @return true when encoding is accepted.
+ */
+bool CoreCompress::accepts(std::string_view accept_encoding, std::string_view encoding) {
+	bool accepted = false;
+
+	while (!accept_encoding.empty()) {
+		size_t comma = accept_encoding.find(',');
+		std::string_view item = accept_encoding.substr(0, comma);
+		accept_encoding = comma == std::string_view::npos ? std::string_view() : accept_encoding.substr(comma + 1);
+
+		size_t semicolon = item.find(';');
+		std::string_view name   = item.substr(0, semicolon);
+		std::string_view params = semicolon == std::string_view::npos ? std::string_view() : item.substr(semicolon + 1);
+
+		while (!name.empty() && name.front() == ' ') name.remove_prefix(1);
+		while (!name.empty() && name.back()  == ' ') name.remove_suffix(1);
+
+		// Zero quality, "q=0", "q=0.0" or "q=0.00".
+		while (!params.empty() && params.front() == ' ') params.remove_prefix(1);
+		while (!params.empty() && params.back()  == ' ') params.remove_suffix(1);
+		bool rejected = params.starts_with("q=0") && params.find_first_not_of("0.", 3) == std::string_view::npos;
+
+		bool exact = name.length() == encoding.length() && strncasecmp(name.data(), encoding.data(), name.length()) == 0;
+
+		// Exact match wins over wildcard.
+		if (exact) return !rejected;
+		if (name == "*") accepted = !rejected;
+	}
+
+	return accepted;
+}
@@ -0,0 +1,54 @@
+#ifndef CORE_COMPRESS_HPP
+#define CORE_COMPRESS_HPP
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Response compression stage. Negotiates gzip or deflate from Accept-Encoding
+ * for content types in the allowlist above a minimum size, and keeps a
+ * memory-bounded LRU cache of compressed content marked cacheable.
+ */
+class CoreCompress {
+	public:
+		CoreCompress(
+			const size_t minimum = 1024,
+			const std::vector<std::string> &types = {
+				"text/html", "text/css", "text/plain", "text/xml", "text/csv", "text/javascript",
+				"application/json", "application/javascript", "application/xml", "image/svg+xml"
+			},
+			const int level = 6,
+			const size_t cache_size = 16777216
+		);
+
+		bool allows(std::string_view content_type, const size_t length) const;
+		std::string_view negotiate(std::string_view accept_encoding) const;
+		std::string compress(std::string_view content, std::string_view encoding) const;
+		std::shared_ptr<const std::string> cached(const std::string &key, std::string_view content, std::string_view encoding);
+
+		static bool accepts(std::string_view accept_encoding, std::string_view encoding);
+
+	private:
+		struct Entry {
+			std::shared_ptr<const std::string> content;
+			std::list<std::string>::iterator used;
+		};
+
+		const size_t minimum;
+		const std::vector<std::string> types;
+		const int level;
+		const size_t cache_size;
+
+		std::mutex mutex;
+		std::list<std::string> used;
+		std::unordered_map<std::string, Entry> cache;
+		size_t cached_size = 0;
+};
+
+#endif
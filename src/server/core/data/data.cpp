@@ -0,0 +1,186 @@
+#include <core/data/data.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+
+/**
+ * Trim spaces and tabs from both ends of view.
+ * @param  value - View to trim.
+ * @return trimmed view.
+ */
+static std::string_view trim(std::string_view value) {
+	while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+	while (!value.empty() && (value.back()  == ' ' || value.back()  == '\t')) value.remove_suffix(1);
+	return value;
+}
+
+/**
+ * Create empty data.
+ * @param arena Memory for fields and decoded values.
+ */
+CoreData::CoreData(std::pmr::memory_resource *arena):
+	fields(arena), decoded(arena) {
+}
+
+/**
+ * Add key-value pair source, for example url query or form body.
+ * @param source    Pairs that have to outlive the data.
+ * @param equal     Symbol that splits key and value.
+ * @param separator Symbol that splits pairs.
+ * @param decode    Wether keys and values are percent-encoded.
+ */
+void CoreData::pairs(std::string_view source, const char equal, const char separator, const bool decode) {
+	if (source.empty() || this -> source_count == this -> sources.size()) return;
+
+	this -> sources[this -> source_count++] = {source, equal, separator, decode};
+	this -> parsed = false;
+}
+
+/**
+ * Add JSON body, members of its top-level object become fields.
+ * @param body JSON that has to outlive the data.
+ */
+void CoreData::json(std::string_view body) {
+	this -> body   = body;
+	this -> parsed = false;
+}
+
+/**
+ * Check wether field exists.
+ * @param key Field key.
+ */
+bool CoreData::contains(std::string_view key) const {
+	return this -> find(key).has_value();
+}
+
+/**
+ * Get every field sorted by key.
+ */
+const std::pmr::vector<CoreData::Field> &CoreData::getFields() const {
+	this -> parse();
+	return this -> fields;
+}
+
+/**
+ * Percent-decode value.
+ * @param value   Encoded value.
+ * @param decoded Decoded value.
+ * @param plus    Wether '+' means space, as in queries and forms.
+ * @return false when value has nothing to decode and decoded is untouched.
+ */
+bool CoreData::decode(std::string_view value, std::pmr::string &decoded, const bool plus) {
+	if (value.find('%') == std::string_view::npos && (!plus || value.find('+') == std::string_view::npos)) return false;
+
+	decoded.clear();
+	decoded.reserve(value.length());
+
+	for (size_t i = 0; i < value.length(); i++) {
+		unsigned char byte = 0;
+
+		if (value[i] == '%' && i + 2 < value.length() && std::from_chars(value.data() + i + 1, value.data() + i + 3, byte, 16).ptr == value.data() + i + 3) {
+			decoded.push_back(static_cast<char>(byte));
+			i += 2;
+		} else if (value[i] == '+' && plus) {
+			decoded.push_back(' ');
+		} else {
+			decoded.push_back(value[i]);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Parse every source once, on first access.
+ */
+void CoreData::parse() const {
+	if (this -> parsed) return;
+	this -> parsed = true;
+
+	this -> fields.clear();
+	this -> decoded.clear();
+
+	for (size_t i = 0; i < this -> source_count; i++) {
+		this -> parsePairs(this -> sources[i]);
+	}
+
+	if (!this -> body.empty()) {
+		this -> parseJSON();
+	}
+
+	// Stable sort keeps source order of equal keys, last one wins on lookup.
+	std::stable_sort(this -> fields.begin(), this -> fields.end(), [](const Field &a, const Field &b) {
+		return a.first < b.first;
+	});
+}
+
+/**
+ * Read pairs of source into fields, views point into source unless decoded.
+ * @param source Pair source.
+ */
+void CoreData::parsePairs(const Source &source) const {
+	std::string_view text = source.text;
+
+	while (!text.empty()) {
+		size_t split = text.find(source.separator);
+		std::string_view pair = trim(text.substr(0, split));
+		text = split == std::string_view::npos ? std::string_view() : text.substr(split + 1);
+
+		size_t equal = pair.find(source.equal);
+		if (equal == std::string_view::npos || equal == 0) continue;
+
+		std::string_view key   = pair.substr(0, equal);
+		std::string_view value = pair.substr(equal + 1);
+
+		// Only encoded keys and values are copied.
+		if (source.decode) {
+			std::pmr::string buffer(this -> fields.get_allocator());
+
+			if (CoreData::decode(key, buffer)) {
+				key = this -> decoded.emplace_back(std::move(buffer));
+			}
+
+			if (CoreData::decode(value, buffer)) {
+				value = this -> decoded.emplace_back(std::move(buffer));
+			}
+		}
+
+		this -> fields.emplace_back(key, value);
+	}
+}
+
+/**
+ * Read top-level members of JSON object body into fields. Strings keep their
+ * value, other values their JSON text, nulls are left out.
+ */
+void CoreData::parseJSON() const {
+	nlohmann::json json = nlohmann::json::parse(this -> body.begin(), this -> body.end(), nullptr, false);
+	if (json.is_discarded() || !json.is_object()) return;
+
+	for (auto it = json.begin(); it != json.end(); it++) {
+		if (it.value().is_null()) continue;
+
+		std::string_view key   = this -> decoded.emplace_back(std::string_view(it.key()));
+		std::string_view value = this -> decoded.emplace_back(std::string_view(
+			it.value().is_string() ? it.value().get_ref<const std::string&>() : it.value().dump()
+		));
+
+		this -> fields.emplace_back(key, value);
+	}
+}
+
+/**
+ * Find raw value of field, parses data on first call.
+ * @param key Field key.
+ * @return value or nullopt.
+ */
+std::optional<std::string_view> CoreData::find(std::string_view key) const {
+	this -> parse();
+
+	auto found = std::upper_bound(this -> fields.begin(), this -> fields.end(), key, [](std::string_view key, const Field &field) {
+		return key < field.first;
+	});
+
+	if (found == this -> fields.begin() || (found - 1) -> first != key) return std::nullopt;
+	return (found - 1) -> second;
+}
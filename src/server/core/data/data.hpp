@@ -0,0 +1,95 @@
+#ifndef CORE_DATA_HPP
+#define CORE_DATA_HPP
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <deque>
+#include <memory_resource>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Request data parsed on first access from key-value pair sources (url query,
+ * form body, cookies) and JSON object bodies. Fields are kept in a sorted flat
+ * map of views into the request, only decoded values are copied.
+ */
+class CoreData {
+	public:
+		using Field = std::pair<std::string_view, std::string_view>;
+
+		CoreData(std::pmr::memory_resource *arena = std::pmr::get_default_resource());
+
+		void pairs(std::string_view source, const char equal, const char separator, const bool decode = true);
+		void json(std::string_view body);
+
+		template <typename T = std::string_view>
+		std::optional<T> get(std::string_view key) const;
+
+		bool contains(std::string_view key) const;
+		const std::pmr::vector<Field> &getFields() const;
+
+		static bool decode(std::string_view value, std::pmr::string &decoded, const bool plus = true);
+
+	private:
+		// Sources are parsed in order, later fields win over earlier ones with the same key.
+		struct Source {
+			std::string_view text;
+			char equal     = '=';
+			char separator = '&';
+			bool decode    = true;
+		};
+
+		std::array<Source, 2> sources;
+		size_t source_count = 0;
+		std::string_view body;
+
+		mutable bool parsed = false;
+		mutable std::pmr::vector<Field> fields;
+		mutable std::pmr::deque<std::pmr::string> decoded;
+
+		void parse() const;
+		void parsePairs(const Source &source) const;
+		void parseJSON() const;
+		std::optional<std::string_view> find(std::string_view key) const;
+};
+
+/**
+ * Get value converted to T: std::string_view, std::string, bool or a number type.
+ * Numbers are parsed without exceptions, for example data.get<int>("page").value_or(1).
+ * @param key Field key.
+ * @return value or nullopt when key is missing or value does not convert.
+ */
+template <typename T>
+std::optional<T> CoreData::get(std::string_view key) const {
+	std::optional<std::string_view> value = this -> find(key);
+	if (!value) return std::nullopt;
+
+	if constexpr (std::is_same_v<T, std::string_view>) {
+		return value;
+
+	} else if constexpr (std::is_same_v<T, std::string>) {
+		return std::string(*value);
+
+	} else if constexpr (std::is_same_v<T, bool>) {
+		if (*value == "true"  || *value == "1" || *value == "on")  return true;
+		if (*value == "false" || *value == "0" || *value == "off") return false;
+		return std::nullopt;
+
+	} else if constexpr (std::is_arithmetic_v<T>) {
+		T number{};
+		auto result = std::from_chars(value -> data(), value -> data() + value -> length(), number);
+
+		if (result.ec != std::errc() || result.ptr != value -> data() + value -> length()) return std::nullopt;
+		return number;
+
+	} else {
+		static_assert(std::is_arithmetic_v<T>, "CoreData::get supports string_view, string, bool and number types.");
+	}
+}
+
+#endif
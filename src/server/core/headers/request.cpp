@@ -1,272 +1,326 @@
 #include <core/headers/request.hpp>
-#include <iostream>
+#include <core/body/body.hpp>
+#include <core/scan/scan.hpp>
 #include <boost/algorithm/string.hpp>
-#include <nlohmann/json.hpp>
-
-Request::Request(std::string &headers):
-	headers(headers),
-	method (this -> readSegment  (headers)),
-	url    (this -> readSegment  (headers)),
-	path   (this -> readPathQuery(this -> url, true)),
-	query  (this -> readPathQuery(this -> url, false)),
-	version(this -> readSegment  (headers)),
-	content_type
-	       (this -> readLineValue(headers, "Content-Type")),
-	cookies(this -> readPairs    (this -> readLineValue(headers, "Cookie"), "=", ";")),
-	body   (this -> readBody     (headers)),
-	data   (this -> readData     (this -> query, this -> body, this -> content_type))
-{}
+
+#include <charconv>
+#include <strings.h>
+
+/**
+ * Trim spaces and tabs from both ends of view.
+ * @param  value - View to trim.
+ * @return trimmed view.
+ */
+static std::string_view trim(std::string_view value) {
+	while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+	while (!value.empty() && (value.back()  == ' ' || value.back()  == '\t')) value.remove_suffix(1);
+	return value;
+}
+
+/**
+ * Get position after the line break at position.
+ * @param  raw      - Raw request.
+ * @param  position - Position where the line ends.
+ * @return position of the next line, npos when line does not end with a line break.
+ */
+static size_t nextLine(std::string_view raw, const size_t position) {
+	if (position < raw.length() && raw[position] == '\n') return position + 1;
+	if (position + 1 < raw.length() && raw[position] == '\r' && raw[position + 1] == '\n') return position + 2;
+
+	return std::string_view::npos;
+}
+
+/**
+ * Parse request line and header fields from the raw request.
+ * @param raw    - Raw request that has to outlive the Request.
+ * @param stream - Body received separately from raw request, kept in memory or spilled to a file.
+ * @param arena  - Memory for header, param and data indexes.
+ */
+Request::Request(std::string_view raw, const CoreBody *stream, std::pmr::memory_resource *arena):
+	raw(raw), stream(stream), fields(arena), params(arena), data(arena), cookies(arena) {
+		this -> fields.reserve(16);
+		this -> readFields(raw, this -> readRequestLine(raw));
+
+		if (this -> stream) {
+			this -> body = this -> stream -> view();
+		}
+
+		// Split URL to path and query, query keeps its '?'.
+		size_t query_start = this -> url.find('?');
+		this -> path  = this -> url.substr(0, query_start);
+		this -> query = query_start != std::string_view::npos ? this -> url.substr(query_start) : std::string_view();
+
+		this -> content_type = this -> getHeader("Content-Type");
+		this -> connection   = this -> getHeader("Connection");
+		this -> cookies.pairs(this -> getHeader("Cookie"), '=', ';', false);
+		this -> readData(this -> query, this -> body, this -> content_type);
+}
 
 bool Request::isValid() const {
-	return method.length() > 0 && url.length() > 0 && version.length() > 0;
+	return !malformed && method.length() > 0 && url.length() > 0 && version.length() > 0;
+}
+
+/**
+ * Check wether client wants to keep the connection open after response.
+ * HTTP/1.1 keeps connections open unless closed, HTTP/1.0 only on request.
+ */
+bool Request::isKeepAlive() const {
+	if (boost::algorithm::iequals(this -> connection, "close")) return false;
+	if (boost::algorithm::iequals(this -> connection, "keep-alive")) return true;
+
+	return this -> version == "HTTP/1.1";
 }
 
 /**
- * Get raw headers.
+ * Get raw request.
  */
-const std::string &Request::getHeaders() const {
-	return this -> headers;
+std::string_view Request::getHeaders() const {
+	return this -> raw;
 }
 
 /**
  * Get header method.
  */
-const std::string &Request::getMethod() const {
+std::string_view Request::getMethod() const {
 	return this -> method;
 }
 
 /**
  * Get header URL.
  */
-const std::string &Request::getURL() const {
+std::string_view Request::getURL() const {
 	return this -> url;
 }
 
 /**
  * Get header path.
  */
-const std::string &Request::getPath() const {
+std::string_view Request::getPath() const {
 	return this -> path;
 }
 
 /**
  * Get header query.
  */
-const std::string &Request::getQuery() const {
+std::string_view Request::getQuery() const {
 	return this -> query;
 }
 
 /**
  * Get header version.
  */
-const std::string &Request::getVersion() const {
+std::string_view Request::getVersion() const {
 	return this -> version;
 }
 
 /**
  * Get header content-type.
  */
-const std::string &Request::getContentType() const {
+std::string_view Request::getContentType() const {
 	return this -> content_type;
 }
 
+/**
+ * Get header connection.
+ */
+std::string_view Request::getConnection() const {
+	return this -> connection;
+}
+
 /**
  * Get header content body.
  */
-const std::string &Request::getBody() const {
+std::string_view Request::getBody() const {
 	return this -> body;
 }
 
 /**
- * Read line value from headers.
- * @param  headers - Fully read request headers that will be modified after this method is called.
- * @param  key - Line key that will be lowercased.
- * @return value of read line.
+ * Get temporary file path of a large body, empty when body is in memory.
+ * File is removed once the response is done.
  */
-std::string Request::readLineValue(std::string &headers, std::string key) const {
-	std::string headers_copy = boost::algorithm::to_lower_copy(headers);
-	key = boost::algorithm::to_lower_copy(key);
-	size_t start = headers_copy.find(key + ": ");
-	std::string value;
+std::string_view Request::getBodyPath() const {
+	return this -> stream ? std::string_view(this -> stream -> path()) : std::string_view();
+}
 
+/**
+ * Get received body size, also when body is in a file or went to a consumer.
+ */
+size_t Request::getBodySize() const {
+	return this -> stream ? this -> stream -> size() : this -> body.length();
+}
 
-	if (start != std::string::npos) {
-		size_t end = headers_copy.find('\n', start);
-		value = headers.substr(start + key.length() + 2, end - start - key.length() - 3);
+/**
+ * Get value of the first header field with case-insensitive name.
+ * @param  key - Header field name.
+ * @return header value or empty view.
+ */
+std::string_view Request::getHeader(std::string_view key) const {
+	for (const auto &[name, value] : this -> fields) {
+		if (name.length() == key.length() && strncasecmp(name.data(), key.data(), key.length()) == 0) {
+			return value;
+		}
+	}
+
+	return std::string_view();
+}
+
+/**
+ * Get every header field in the order they were received.
+ */
+const std::pmr::vector<Request::Field> &Request::getHeaderFields() const {
+	return this -> fields;
+}
 
-		// Remove read line from headers.
-		headers = headers.substr(0, start) + headers.substr(end + 1);
+/**
+ * Get route param captured by ':name' or '*name' route segment.
+ * @param  key - Param name.
+ * @return param value or empty view.
+ */
+std::string_view Request::getParam(std::string_view key) const {
+	for (const auto &[name, value] : this -> params) {
+		if (name == key) return value;
 	}
 
-	return value;
+	return std::string_view();
 }
 
 /**
- * Read segment where separator is space or newline.
- * @param  headers - Fully read request headers that will be modified after this method is called.
- * @return segment and modify the source headers string.
+ * Get every captured route param in path order.
  */
-std::string Request::readSegment(std::string &headers) const {
-	std::string segment;
+const std::pmr::vector<Request::Field> &Request::getParams() const {
+	return this -> params;
+}
 
-	for (auto iterator = headers.begin(); iterator != headers.end(); iterator++) {
-		if (*iterator == ' ' || *iterator == '\n' || *iterator == '\r') break;
-		segment += *iterator;
+/**
+ * Read method, URL and version from the request line. Line ends at the first
+ * control character, which has to be its line break. Method has to be a token.
+ * @param  raw - Raw request.
+ * @return position where header fields start.
+ */
+size_t Request::readRequestLine(std::string_view raw) {
+	size_t end  = CoreScan::value(raw);
+	size_t next = end == raw.length() ? end : nextLine(raw, end);
+	std::string_view line = raw.substr(0, end);
+
+	size_t method = CoreScan::token(line);
+	this -> malformed = next == std::string_view::npos || method == 0 || (method < line.length() && line[method] != ' ');
+
+	// Rest of a broken line is skipped.
+	if (next == std::string_view::npos) {
+		next = raw.find('\n', end);
+		next = next == std::string_view::npos ? raw.length() : next + 1;
 	}
 
-	if (segment.length() + 1 <= headers.length()) {
-		headers = headers.substr(segment.length() + 1);
+	// Segments are separated by single spaces.
+	std::string_view *segments[] = {&this -> method, &this -> url, &this -> version};
+	for (std::string_view *segment : segments) {
+		size_t space = line.find(' ');
+		*segment = line.substr(0, space);
+		line = space == std::string_view::npos ? std::string_view() : line.substr(space + 1);
 	}
 
-	return segment;
+	return next;
 }
 
 /**
- * Read path or query from url without modifying any sources.
- * @param  url  - URL read from headers.
- * @param  path - True if reading path, false if reading query.
- * @return path or query from URL.
+ * Index header fields and find body, nothing is copied. Field names are
+ * scanned as tokens up to their colon and values up to the first control
+ * character, which has to be the line break. Other fields make the request
+ * malformed and are skipped.
+ * @param  raw      - Raw request.
+ * @param  position - Position where header fields start.
+ * @return position where body starts.
  */
-std::string Request::readPathQuery(const std::string &url, const bool &path) const {
-	std::size_t query_start = url.find('?');
-
-	// Query found.
-	if (query_start != std::string::npos) {
-		if (path) {
-			return url.substr(0, query_start);
-		} else {
-			return url.substr(query_start);
+size_t Request::readFields(std::string_view raw, size_t position) {
+	while (position < raw.length()) {
+		std::string_view line = raw.substr(position);
+
+		// Empty line ends headers.
+		size_t next = nextLine(line, 0);
+
+		if (next != std::string_view::npos) {
+			position += next;
+			this -> body = raw.substr(position);
+			return position;
 		}
 
-	// Query not found.
-	} else return path ? url : "";
+		size_t name  = CoreScan::token(line);
+		size_t start = name + 1;
+		size_t end   = name < line.length() ? start + CoreScan::value(line.substr(start)) : line.length();
+
+		// Headers did not end, request has no body.
+		if (end >= line.length()) return raw.length();
+
+		next = nextLine(line, end);
+
+		if (name == 0 || line[name] != ':' || next == std::string_view::npos) {
+			this -> malformed = true;
+			next = line.find('\n', name);
+			if (next == std::string_view::npos) return raw.length();
+
+			position += next + 1;
+			continue;
+		}
+
+		this -> fields.emplace_back(line.substr(0, name), trim(line.substr(start, end - start)));
+		position += next;
+	}
+
+	return position;
 }
 
 /**
- * Read headers data, body data and query data.
- * @param headers - Fully read request headers that will be modified after this method is called.
+ * Register query data, form data and JSON body data, parsed on first access.
  * @param query - Data query that is part of the URL.
- * @return map of any data.
+ * @param body - Request body.
+ * @param content_type - Request body content type.
  */
-std::map<std::string, std::any> Request::readData(const std::string &query, const std::string &body, const std::string &content_type) const {
-	std::map<std::string, std::any> data;
-
+void Request::readData(std::string_view query, std::string_view body, std::string_view content_type) {
 	// Query data.
 	if (!query.empty()) {
-		data = this -> readPairs(query.substr(1), "=", "&");
+		this -> data.pairs(query.substr(1), '=', '&');
 	}
 
-	// Body data - JSON.
-	if (content_type == "applications/json") { try {
-		nlohmann::json json = nlohmann::json::parse(body);
-		for (auto it = json.begin(); it != json.end(); it++) {
-			if (it.value().is_string()) {
-				data[it.key()] = it.value().get<std::string>();
-			}
-		}
-	} catch (...) {} }
+	// Body data by media type, parameters such as charset are ignored.
+	std::string_view media = content_type.substr(0, content_type.find(';'));
+	while (!media.empty() && (media.back() == ' ' || media.back() == '\t')) media.remove_suffix(1);
+
+	if (media.length() == 33 && strncasecmp(media.data(), "application/x-www-form-urlencoded", 33) == 0) {
+		this -> data.pairs(body, '=', '&');
 
-	return data;
+	} else if ((media.length() == 16 && strncasecmp(media.data(), "application/json", 16) == 0) || (media.length() > 5 && strncasecmp(media.data() + media.length() - 5, "+json", 5) == 0)) {
+		this -> data.json(body);
+	}
 }
 
 /**
- * Get reference to all data read from headers, body and url query.
+ * Get all data read from url query, form body and JSON body.
  */
-const std::map<std::string, std::any> &Request::getData() const {
+const CoreData &Request::getData() const {
 	return this -> data;
 }
 
 /**
- * Get copy of one specific data read from headers, body or url query. Value can be empty.
+ * Get one specific data value read from url query, form body or JSON body.
  * @param  key - Data key to look for.
- * @return copy from data that can be empty.
+ * @return value, empty when missing.
  */
-std::any Request::getData(const std::string &key) const {
-	std::any data;
-
-	// Get data from specific location.
-	if (this -> data.contains(key)) {
-		data = this -> data.at(key);
-	}
-
-	return data;
+std::string_view Request::getData(std::string_view key) const {
+	return this -> data.get(key).value_or(std::string_view());
 }
 
 /**
- * Get reference to all cookies.
+ * Get all cookies.
  */
-const std::map<std::string, std::any> &Request::getCookies() const {
+const CoreData &Request::getCookies() const {
 	return this -> cookies;
 }
 
 /**
- * Get copy of one specific cookie. Value can be empty.
+ * Get one specific cookie value.
  * @param  key - Cookie name to look for.
- * @return copy from cookies that can be empty.
+ * @return value, empty when missing.
  */
-std::any Request::getCookie(const std::string &key) const {
-	std::any cookie;
-
-	// Get data from specific location.
-	if (this -> cookies.contains(key)) {
-		cookie = this -> cookies.at(key);
-	}
-
-	return cookie;
-}
-
-/**
- * General method to read pairs of data (for example query, cookies).
- * @param source    - Source string where pairs are located.
- * @param equal     - Equal symbol that splits key and value.
- * @param separator - Separator symbol that splits key and value pairs.
- * @return map of any values.
- */
-std::map<std::string, std::any> Request::readPairs(std::string source, const std::string &equal, const std::string &separator) const {
-	std::map<std::string, std::any> pairs;
-
-	// Loop source until all pairs have been used.
-	size_t symbol_equal, symbol_separator, split;
-	while ((symbol_equal = source.find(equal)) != std::string::npos) {
-		std::string key = source.substr(0, symbol_equal);
-		std::string value = source.substr(symbol_equal + 1);
-		split = key.length();
-
-		// Remove other keys/values from current value.
-		if ((symbol_separator = value.find(separator)) != std::string::npos) {
-			value = value.substr(0, symbol_separator);
-			split += 1;
-		}
-		split += value.length();
-
-		// Boolean.
-		if (value == "false" || value == "true") {
-			pairs[key] = value == "true";
-		} else {
-
-			// Integer.
-			try {
-				pairs[key] = std::stoi(value);
-
-			// String.
-			} catch (...) {
-				pairs[key] = value;
-			}
-		}
-		// Cut found pair from source.
-		source = source.substr(split);
-	}
-
-	return pairs;
-}
-
-std::string Request::readBody(std::string &headers) const {
-	std::string body;
-
-	size_t start = headers.find("\r\n\r\n");
-	if (start != std::string::npos) {
-		body = headers.substr(start + 4);
-	}
-
-	return body;
+std::string_view Request::getCookie(std::string_view key) const {
+	return this -> cookies.get(key).value_or(std::string_view());
 }
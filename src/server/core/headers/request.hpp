@@ -1,50 +1,101 @@
 #ifndef CORE_REQUEST_HPP
 #define CORE_REQUEST_HPP
 
+#include <core/data/data.hpp>
+
+#include <memory_resource>
+#include <optional>
 #include <string>
-#include <map>
-#include <any>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class CoreBody;
 
+/**
+ * HTTP Request parsed in one pass. Every view points into the raw request,
+ * which has to outlive the Request.
+ */
 class Request {
 	public:
-		Request(std::string &headers);
-		const std::string &getHeaders() const;
-		const std::string &getMethod() const;
-		const std::string &getURL() const;
-		const std::string &getPath() const;
-		const std::string &getQuery() const;
-		const std::string &getVersion() const;
-		const std::string &getContentType() const;
-		const std::string &getBody() const;
-
-		// Data.
-		const std::map<std::string, std::any> &getData() const;
-		std::any getData(const std::string &key) const;
+		using Field = std::pair<std::string_view, std::string_view>;
+
+		Request(std::string_view raw, const CoreBody *stream = nullptr, std::pmr::memory_resource *arena = std::pmr::get_default_resource());
+		std::string_view getHeaders() const;
+		std::string_view getMethod() const;
+		std::string_view getURL() const;
+		std::string_view getPath() const;
+		std::string_view getQuery() const;
+		std::string_view getVersion() const;
+		std::string_view getContentType() const;
+		std::string_view getConnection() const;
+		std::string_view getBody() const;
+		std::string_view getBodyPath() const;
+		size_t getBodySize() const;
+
+		// Headers.
+		std::string_view getHeader(std::string_view key) const;
+		const std::pmr::vector<Field> &getHeaderFields() const;
+
+		// Route params.
+		std::string_view getParam(std::string_view key) const;
+		const std::pmr::vector<Field> &getParams() const;
+
+		// Data from url query, form and JSON body.
+		const CoreData &getData() const;
+		std::string_view getData(std::string_view key) const;
+		template <typename T> std::optional<T> getData(std::string_view key) const;
 
 		// Cookies.
-		const std::map<std::string, std::any> &getCookies() const;
-		std::any getCookie(const std::string &key) const;
+		const CoreData &getCookies() const;
+		std::string_view getCookie(std::string_view key) const;
+		template <typename T> std::optional<T> getCookie(std::string_view key) const;
 
 		bool isValid() const;
+		bool isKeepAlive() const;
 
 	private:
-		const std::string headers;
-		const std::string method;
-		const std::string url;
-		const std::string path;
-		const std::string query;
-		const std::string version;
-		const std::string content_type;
-		const std::string body;
-		std::map<std::string, std::any> data;
-		std::map<std::string, std::any> cookies;
-
-		std::string readBody(std::string &headers) const;
-		std::string readLineValue(std::string &headers, std::string key) const;
-		std::string readSegment(std::string &headers) const;
-		std::string readPathQuery(const std::string &url, const bool &path) const;
-		std::map<std::string, std::any> readData(const std::string &query, const std::string &body, const std::string &content_type) const;
-		std::map<std::string, std::any> readPairs(std::string source, const std::string &equal, const std::string &separator) const;
+		std::string_view raw;
+		std::string_view method;
+		std::string_view url;
+		std::string_view path;
+		std::string_view query;
+		std::string_view version;
+		std::string_view content_type;
+		std::string_view connection;
+		std::string_view body;
+		const CoreBody *stream;
+		std::pmr::vector<Field> fields;
+		std::pmr::vector<Field> params;
+		CoreData data;
+		CoreData cookies;
+		bool malformed = false;
+
+		size_t readRequestLine(std::string_view raw);
+		size_t readFields(std::string_view raw, size_t position);
+		void readData(std::string_view query, std::string_view body, std::string_view content_type);
+
+	friend class CoreRouter;
 };
 
+/**
+ * Get data value converted to T, for example request.getData<int>("page").
+ * @param  key - Data key to look for.
+ * @return value or nullopt when missing or not convertible.
+ */
+template <typename T>
+std::optional<T> Request::getData(std::string_view key) const {
+	return this -> data.get<T>(key);
+}
+
+/**
+ * Get cookie value converted to T.
+ * @param  key - Cookie name to look for.
+ * @return value or nullopt when missing or not convertible.
+ */
+template <typename T>
+std::optional<T> Request::getCookie(std::string_view key) const {
+	return this -> cookies.get<T>(key);
+}
+
 #endif
@@ -4,14 +4,26 @@
 #include <iostream>
 #include <ostream>
 #include <unistd.h>
+#include <errno.h>
+#include <charconv>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/sendfile.h>
 #include <stdexcept>
+#include <strings.h>
+#include <chrono>
+
+// Last header line, it is left out of cached responses since it differs per connection.
+static constexpr std::string_view connection_keep_alive = "Connection: keep-alive\r\n\r\n";
+static constexpr std::string_view connection_close      = "Connection: close\r\n\r\n";
 
 /**
  * HTTP Response Headers.
  * @param connection Request connection where to respond.
+ * @param arena      Memory for headers and cookies.
  */
-Response::Response(const int &connection):
-	connection(connection) {
+Response::Response(const int &connection, std::pmr::memory_resource *arena):
+	connection(connection), cookies(arena), headers(arena) {
 }
 
 /**
@@ -20,10 +32,10 @@ Response::Response(const int &connection):
  * @param value - Cookie value.
  */
 void Response::setCookie(const std::string &key, const std::string &value) {
-	std::map<std::string, std::string> cookie;
-	cookie["cookie"] = value;
-
-	this -> cookies[key] = cookie;
+	Cookie &cookie = this -> findCookie(key);
+	cookie.value = value;
+	cookie.path.clear();
+	cookie.age = -1;
 }
 
 /**
@@ -32,22 +44,35 @@ void Response::setCookie(const std::string &key, const std::string &value) {
  * @param value - Cookie value.
  */
 void Response::setCookie(const std::string &key, const std::string &value, const std::string &path, const int &age) {
-	std::map<std::string, std::string> cookie;
-	cookie["cookie"] = value;
-	cookie["path"] = path;
-	cookie["age"] = std::to_string(age);
+	Cookie &cookie = this -> findCookie(key);
+	cookie.value = value;
+	cookie.path  = path;
+	cookie.age   = age;
+}
+
+/**
+ * Find cookie to set by name, new cookies are added.
+ * @param key Cookie name.
+ * @return cookie.
+ */
+Response::Cookie &Response::findCookie(std::string_view key) {
+	for (Cookie &cookie : this -> cookies) {
+		if (cookie.key == key) return cookie;
+	}
 
-	this -> cookies[key] = cookie;
+	// Strings of the cookie use the arena of the response.
+	auto arena = this -> cookies.get_allocator();
+	return this -> cookies.emplace_back(Cookie{std::pmr::string(key, arena), std::pmr::string(arena), std::pmr::string(arena)});
 }
 
 /**
  * Send response to the request as JSON.
  * @param content JSON string.
  */
-void Response::sendJSON(const std::string &json) {
+void Response::sendJSON(std::string json) {
 	this -> throwIsSent();
 	this -> content_type = "application/json";
-	this -> content = json;
+	this -> content = std::move(json);
 	this -> send();
 }
 
@@ -86,132 +111,405 @@ void Response::redirect(const std::string &url) {
 }
 
 /**
- * Get response headers head text.
- * @return headers head (version, code, message).
+ * Serialize response headers into head buffer without temporary strings.
+ * @param head   Buffer to append headers to, ends with the empty line.
+ * @param length Content length.
  */
-std::string Response::getHead() const {
-	std::string head = "";
+void Response::writeHead(std::string &head, const size_t length) const {
+	char number[24];
+
+	// Status line, preformatted for default version.
+	if (this -> version == "HTTP/1.1") {
+		head.append(Status::line(this -> status_code));
+	} else {
+		head.append(this -> version).append(" ");
+		head.append(number, std::to_chars(number, number + sizeof(number), this -> status_code).ptr);
+		head.append(" ").append(Status::get(this -> status_code)).append("\r\n");
+	}
+
+	// Redirect location.
+	if (this -> isRedirected()) {
+		head.append("Location: ").append(this -> content).append("\r\n");
+	}
+
+	// Cookies to be set.
+	for (const Cookie &cookie : this -> cookies) {
+		head.append("Set-Cookie: ").append(cookie.key).append("=").append(cookie.value);
 
-	head.append(this -> version + " ");
-	head.append(std::to_string(this -> status_code) + " ");
-	head.append(Status::get(this -> status_code) + "\r\n");
+		if (cookie.age >= 0) {
+			head.append("; Max-Age=");
+			head.append(number, std::to_chars(number, number + sizeof(number), cookie.age).ptr);
+		}
 
-	return head;
+		if (!cookie.path.empty()) head.append("; Path=").append(cookie.path);
+		head.append("; Secure; HttpOnly\r\n");
+	}
+
+	// Custom headers.
+	for (const auto &[key, value] : this -> headers) {
+		head.append(key).append(": ").append(value).append("\r\n");
+	}
+
+	// Content type, charset and length, redirects have empty content.
+	if (this -> hasContent()) {
+		head.append("Content-Type: ").append(this -> content_type);
+		if (!this -> charset.empty()) head.append("; charset=").append(this -> charset);
+
+		// Streamed length is unknown, without chunks the end is marked by closing.
+		if (length == streamed) {
+			head.append(this -> chunked ? "\r\nTransfer-Encoding: chunked\r\n" : "\r\n");
+		} else {
+			head.append("\r\nContent-Length: ");
+			head.append(number, std::to_chars(number, number + sizeof(number), length).ptr);
+			head.append("\r\n");
+		}
+	} else if (this -> isRedirected()) {
+		head.append("Content-Length: 0\r\n");
+	}
+
+	head.append(this -> keep_alive ? connection_keep_alive : connection_close);
 }
 
 /**
- * Get response headers redirect location.
- * @return headers location if redirected.
+ * Write head and body with vectored writes, body is not copied. When socket
+ * is not writable the rest goes to the reactor backlog. Without one the socket
+ * blocks up to its send timeout, the response is broken after that.
+ * @param head Serialized headers.
+ * @param body Response content.
+ * @return bytes written directly to the socket.
  */
-std::string Response::getRedirect() const {
-	std::string redirect = "";
+size_t Response::write(std::string_view head, std::string_view body) {
+	if (this -> timed) {
+		auto started = std::chrono::steady_clock::now();
+		this -> timed = false;
+		size_t written = this -> write(head, body);
+		this -> timed = true;
+		this -> write_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+		return written;
+	}
 
-	if (this -> isRedirected()) {
-		redirect = "Location: " + this -> content + "\r\n";
+	// Earlier output still waiting or owner submits output itself, keep response order.
+	if (this -> backlog && (!this -> backlog -> empty() || this -> backlog -> isDeferred())) {
+		this -> backlog -> append(head);
+		this -> backlog -> append(body);
+		return 0;
 	}
 
-	return redirect;
+	size_t total   = head.length() + body.length();
+	size_t written = 0;
+
+	while (written < total) {
+		iovec parts[2];
+		int count = 0;
+
+		if (written < head.length()) {
+			parts[count++] = {const_cast<char*>(head.data()) + written, head.length() - written};
+			parts[count++] = {const_cast<char*>(body.data()), body.length()};
+		} else {
+			parts[count++] = {const_cast<char*>(body.data()) + written - head.length(), total - written};
+		}
+
+		msghdr message = {};
+		message.msg_iov    = parts;
+		message.msg_iovlen = count;
+
+		ssize_t size = sendmsg(this -> connection, &message, MSG_NOSIGNAL);
+
+		if (size > 0) {
+			written += size;
+
+		} else if (size == -1 && errno == EINTR) {
+			continue;
+
+		// Socket buffer full.
+		} else if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (this -> backlog) {
+				if (written < head.length()) {
+					this -> backlog -> append(head.substr(written));
+					this -> backlog -> append(body);
+				} else {
+					this -> backlog -> append(body.substr(written - head.length()));
+				}
+
+				return written;
+			}
+
+			// Blocking socket ran out of its send timeout, the client stopped reading.
+			this -> broken     = true;
+			this -> keep_alive = false;
+			return written;
+
+		// Client is gone, connection can not be reused.
+		} else {
+			this -> broken     = true;
+			this -> keep_alive = false;
+			return written;
+		}
+	}
+
+	return written;
 }
 
 /**
- * Get response headers content type and charset.
- * @return headers content type and charset.
+ * Send response to the request. Connection is closed by its owner.
  */
-std::string Response::getContentType() const {
-	std::string content_type = "";
+void Response::send() {
+	this -> sendView(this -> content);
+}
+
+/**
+ * Send content that stays valid during the call, without copying it into the response.
+ * @param content Content to send to the request.
+ */
+void Response::sendView(std::string_view content) {
+	this -> throwIsSent();
 
-	if (!this -> isRedirected()) {
-		content_type = "Content-Type: " + this -> content_type + "; " + this -> getCharset() + "\r\n";
+	if (!this -> hasContent()) {
+		content = std::string_view();
 	}
 
-	return content_type;
+	// Compressed content lives until it is written or queued.
+	std::string encoded;
+	std::shared_ptr<const std::string> cached;
+	content = this -> encode(content, encoded, cached);
+
+	// Headers go to a per thread buffer reused by every response.
+	static thread_local std::string head;
+	head.clear();
+	this -> writeHead(head, content.length());
+
+	// HEAD requests get headers only.
+	this -> write(head, this -> head_only ? std::string_view() : content);
+
+	// Keep serialized response for the route cache.
+	if (this -> capture && this -> isShared()) {
+		this -> capture -> head = head.length() - (this -> keep_alive ? connection_keep_alive : connection_close).length();
+		this -> capture -> bytes.reserve(this -> capture -> head + content.length());
+		this -> capture -> bytes.assign(head, 0, this -> capture -> head);
+		this -> capture -> bytes.append(content);
+	}
+
+	// Set headers sent.
+	this -> sent = true;
+}
+
+/**
+ * Send cached response, only the Connection header is added.
+ * @param entry Serialized response.
+ */
+void Response::sendCached(const CoreCache::Entry &entry) {
+	this -> throwIsSent();
+
+	static thread_local std::string head;
+	head.assign(entry.bytes, 0, entry.head);
+	head.append(this -> keep_alive ? connection_keep_alive : connection_close);
+
+	this -> write(head, this -> head_only ? std::string_view() : std::string_view(entry.bytes).substr(entry.head));
+	this -> sent = true;
 }
 
 /**
- * Get response content.
- * @return headers content.
+ * Check wether response may be served to every client from the cache:
+ * 200 without cookies, not marked private or no-store and not for a HEAD request.
+ * @return true when response is shared.
  */
-std::string Response::getContent() const {
-	std::string content = "";
+bool Response::isShared() const {
+	if (this -> status_code != 200 || this -> head_only || !this -> cookies.empty()) return false;
 
-	if (!this -> isRedirected()) {
-		content.append("\r\n");
-		content.append(this -> content);
+	for (const auto &[key, value] : this -> headers) {
+		if (key.length() == 13 && strncasecmp(key.data(), "Cache-Control", 13) == 0 && (value.find("no-store") != std::string::npos || value.find("private") != std::string::npos)) {
+			return false;
+		}
 	}
 
-	return content;
+	return true;
 }
 
 /**
- * Get response headers charset.
- * @return headers charset.
+ * Send file range with sendfile, file is not read into memory. Caller keeps
+ * file open, queued ranges use their own descriptor.
+ * @param file   Open file.
+ * @param offset Range start.
+ * @param length Range length.
  */
-std::string Response::getCharset() const {
-	return "charset=" + this -> charset;
+void Response::sendFile(const int file, off_t offset, size_t length) {
+	this -> throwIsSent();
+
+	static thread_local std::string head;
+	head.clear();
+	this -> writeHead(head, this -> hasContent() ? length : 0);
+
+	// Headers first, file range queues behind them when socket is full.
+	if (this -> write(head, std::string_view()) < head.length() || !this -> hasContent() || this -> head_only) {
+		if (this -> hasContent() && this -> backlog && !this -> broken && !this -> head_only) {
+			this -> backlog -> appendFile(file, offset, length);
+		}
+
+		this -> sent = true;
+		return;
+	}
+
+	auto started = this -> timed ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+
+	while (length > 0) {
+		ssize_t size = sendfile(this -> connection, file, &offset, length);
+
+		if (size > 0) {
+			length -= size;
+
+		} else if (size == -1 && errno == EINTR) {
+			continue;
+
+		// Socket buffer full.
+		} else if (size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (this -> backlog) {
+				this -> backlog -> appendFile(file, offset, length);
+				break;
+			}
+
+			// Blocking socket ran out of its send timeout, the client stopped reading.
+			this -> broken     = true;
+			this -> keep_alive = false;
+			break;
+
+		// Client is gone or file shrank.
+		} else {
+			this -> broken     = true;
+			this -> keep_alive = false;
+			break;
+		}
+	}
+
+	if (this -> timed) {
+		this -> write_time += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+	}
+
+	this -> sent = true;
 }
 
 /**
- * Get response headers content length.
- * @return headers content length.
+ * Send headers and stream content after them. Write chunks with stream -> write()
+ * and finish with stream -> end(), HEAD requests get a stream that is already ended.
+ * Stream stays usable after the route returns, from any thread.
+ * @return stream of the response content.
  */
-std::string Response::getContentLength() const {
-	std::string content_length = "";
+std::shared_ptr<CoreStream> Response::stream() {
+	this -> throwIsSent();
 
-	if (!this -> isRedirected()) {
-		content_length = "Content-Length: " + std::to_string(this -> content.length()) + "\r\n";
+	// Without chunks only closing the connection ends the content.
+	if (!this -> chunked) {
+		this -> keep_alive = false;
 	}
 
-	return content_length;
+	static thread_local std::string head;
+	head.clear();
+	this -> writeHead(head, streamed);
+	this -> write(head, std::string_view());
+	this -> sent = true;
+
+	auto stream = std::make_shared<CoreStream>(this -> connection, this -> chunked, this -> queued);
+
+	if (this -> head_only || this -> broken || !this -> hasContent()) {
+		stream -> ended = true;
+		return stream;
+	}
+
+	this -> streaming = stream;
+	return stream;
 }
 
 /**
- * Get response headers cookies to be set.
- * @return headers cookies.
+ * Stream server-sent events, for example stream -> event("{...}", "update").
+ * @return stream of the events.
  */
-std::string Response::getCookies() const {
-	std::string cookies = "";
+std::shared_ptr<CoreStream> Response::events() {
+	this -> type("text/event-stream");
+	this -> header("Cache-Control", "no-cache");
+	return this -> stream();
+}
 
-	for (const auto &[key, cookie] : this -> cookies) {
-		cookies.append("Set-Cookie: " + key + "=" + cookie.at("cookie"));
-		cookies.append(cookie.contains("age") ? "; Max-Age=" + cookie.at("age") : "");
-		cookies.append(cookie.contains("path") ? "; Path=" + cookie.at("path") : "");
-		cookies.append("; Secure; HttpOnly\r\n");
+/**
+ * Compress content when compression is enabled, content type and size are
+ * allowed and client accepts an encoding. Partial content is never compressed.
+ * @param content Content to send.
+ * @param encoded Storage for compressed content.
+ * @param cached  Storage for cached compressed content.
+ * @return content to send.
+ */
+std::string_view Response::encode(std::string_view content, std::string &encoded, std::shared_ptr<const std::string> &cached) {
+	if (!this -> compression || content.empty() || this -> head_only || this -> status_code == 206) return content;
+	if (this -> findHeader("Content-Encoding") || !this -> compression -> allows(this -> content_type, content.length())) return content;
+
+	// Representation depends on Accept-Encoding for every client.
+	this -> headers.emplace_back("Vary", "Accept-Encoding");
+
+	std::string_view encoding = this -> compression -> negotiate(this -> accept_encoding);
+	if (encoding.empty()) return content;
+
+	if (!this -> cache_key.empty()) {
+		cached  = this -> compression -> cached(this -> cache_key, content, encoding);
+		content = *cached;
+	} else {
+		encoded = this -> compression -> compress(content, encoding);
+		content = encoded;
 	}
 
+	this -> headers.emplace_back("Content-Encoding", encoding);
 
+	// Compressed bytes differ, strong validator becomes weak.
+	std::pmr::string *etag = this -> findHeader("ETag");
+	if (etag && !etag -> starts_with("W/")) {
+		etag -> insert(0, "W/");
+	}
 
-	return cookies;
+	return content;
 }
 
 /**
- * Send response to the request.
+ * Find custom response header value.
+ * @param key Header name, case-insensitive.
+ * @return header value or nullptr.
  */
-void Response::send() {
-	this -> throwIsSent();
+std::pmr::string *Response::findHeader(std::string_view key) {
+	for (auto &[name, value] : this -> headers) {
+		if (name.length() == key.length() && strncasecmp(name.data(), key.data(), key.length()) == 0) {
+			return &value;
+		}
+	}
 
-	// Generate headers.
-	std::string response = "";
-	response.append(this -> getHead());
-	response.append(this -> getRedirect());
-	response.append(this -> getCookies());
-	response.append(this -> getContentType());
-	response.append(this -> getContentLength());
-	response.append(this -> getContent());
+	return nullptr;
+}
 
-	// Respond to request.
-	write(this -> connection , response.c_str() , response.length());
-	close(this -> connection);
+/**
+ * Mark content as the same for every response with key, so compressed
+ * content is cached under it.
+ * @param  key Cache key, for example path and version of the content.
+ * @return     self.
+ */
+Response &Response::cache(const std::string &key) {
+	this -> throwIsSent();
+	this -> cache_key = key;
+	return *this;
+}
 
-	// Set headers sent.
-	this -> sent = true;
+/**
+ * Add custom response header.
+ * @param  key   Header name.
+ * @param  value Header value.
+ * @return       self.
+ */
+Response &Response::header(const std::string &key, const std::string &value) {
+	this -> throwIsSent();
+	this -> headers.emplace_back(key, value);
+	return *this;
 }
 
 /**
  * Send response to the request.
  * @param content Content to send to the request.
  */
-void Response::send(const std::string &content) {
-	this -> content = content;
+void Response::send(std::string content) {
+	this -> content = std::move(content);
 	this -> send();
 }
 
@@ -240,5 +538,13 @@ bool Response::isSent() const {
  * @return true if redirected.
  */
 bool Response::isRedirected() const {
-	return this -> status_code >= 300 && this -> status_code < 400;
+	return this -> status_code >= 300 && this -> status_code < 400 && this -> status_code != 304;
+}
+
+/**
+ * Check wether response status allows content.
+ * @return false for redirects, informational, 204 and 304 responses.
+ */
+bool Response::hasContent() const {
+	return !this -> isRedirected() && this -> status_code >= 200 && this -> status_code != 204 && this -> status_code != 304;
 }
@@ -1,47 +1,100 @@
 #ifndef CORE_RESPONSE_HPP
 #define CORE_RESPONSE_HPP
 
-#include <string>
+#include <core/output/output.hpp>
+#include <core/compress/compress.hpp>
+#include <core/stream/stream.hpp>
+#include <core/cache/cache.hpp>
 
-#include <map>
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <memory>
+#include <memory_resource>
 
 class Response {
 	public:
-		Response(const int &connection);
+		Response(const int &connection, std::pmr::memory_resource *arena = std::pmr::get_default_resource());
 
 		std::string version      = "HTTP/1.1";
 		unsigned int status_code = 200;
 		std::string content_type = "text/html";
 		std::string charset      = "utf-8";
 		std::string content      = "";
+		bool keep_alive          = false;
 
 		Response &type(const std::string &content_type);
 		Response &status(const unsigned int &status_code);
+		Response &header(const std::string &key, const std::string &value);
+		Response &cache(const std::string &key);
 
 		bool isSent() const;
 		bool isRedirected() const;
+		bool hasContent() const;
 
-		void sendJSON(const std::string &json);
+		void sendJSON(std::string json);
 		void send();
-		void send(const std::string &content);
+		void send(std::string content);
+		void sendView(std::string_view content);
+		void sendFile(const int file, off_t offset, size_t length);
 		void redirect(const std::string &url);
 
+		std::shared_ptr<CoreStream> stream();
+		std::shared_ptr<CoreStream> events();
+
 		void setCookie(const std::string &key, const std::string &value);
 		void setCookie(const std::string &key, const std::string &value, const std::string &path, const int &age);
 
 	private:
-		const int &connection;
-		bool sent = false;
-		std::map<std::string, std::map<std::string, std::string>> cookies;
+		const int connection;
+		bool sent      = false;
+		bool broken    = false;
+		bool head_only = false;
+		// Cookie to set, age below 0 and empty path are left out.
+		struct Cookie {
+			std::pmr::string key;
+			std::pmr::string value;
+			std::pmr::string path;
+			int age = -1;
+		};
+
+		std::pmr::vector<Cookie> cookies;
+		std::pmr::vector<std::pair<std::pmr::string, std::pmr::string>> headers;
+
+		// Connection output waiting for the socket to become writable, owned by the reactor.
+		CoreOutput *backlog = nullptr;
+
+		// Compression stage, accepted encodings and key of cacheable content.
+		CoreCompress *compression = nullptr;
+		std::string_view accept_encoding;
+		std::string cache_key;
+
+		// Streamed body, chunked unless client is HTTP/1.0, queued to the reactor when it has one.
+		static constexpr size_t streamed = static_cast<size_t>(-1);
+		std::shared_ptr<CoreStream> streaming;
+		bool chunked = true;
+		bool queued  = false;
+
+		// Receives serialized response when route is cached and response is the same for everyone.
+		CoreCache::Entry *capture = nullptr;
+
+		// Time spent writing to the socket, measured when metrics are enabled.
+		bool timed          = false;
+		uint64_t write_time = 0;
 
 		bool throwIsSent() const;
-		std::string getHead() const;
-		std::string getContentType() const;
-		std::string getCharset() const;
-		std::string getContentLength() const;
-		std::string getRedirect() const;
-		std::string getContent() const;
-		std::string getCookies() const;
+		void writeHead(std::string &head, const size_t length) const;
+		size_t write(std::string_view head, std::string_view body);
+		void sendCached(const CoreCache::Entry &entry);
+		bool isShared() const;
+		std::string_view encode(std::string_view content, std::string &encoded, std::shared_ptr<const std::string> &cached);
+		std::pmr::string *findHeader(std::string_view key);
+		Cookie &findCookie(std::string_view key);
+
+	friend class CoreRouter;
 };
 
 #endif
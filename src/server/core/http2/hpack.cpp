@@ -0,0 +1,491 @@
+#include <core/http2/hpack.hpp>
+
+#include <algorithm>
+#include <array>
+
+// Huffman codes of bytes 0-255 and end of string, RFC 7541 appendix B.
+static constexpr uint32_t huffman_codes[257] = {
+	0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+	0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+	0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+	0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+	0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+	0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+	0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+	0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+	0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+	0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+	0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+	0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+	0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+	0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+	0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+	0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+	0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+	0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+	0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+	0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+	0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+	0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+	0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+	0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+	0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+	0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+	0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+	0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+	0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+	0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+	0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+	0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+	0x3fffffff
+};
+
+static constexpr uint8_t huffman_lengths[257] = {
+	13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+	28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+	6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+	5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+	13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+	7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+	15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+	6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+	20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+	24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+	22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+	21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+	26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+	19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+	20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+	26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+	30
+};
+
+// Static table, RFC 7541 appendix A, indexes start at 1.
+static constexpr std::array<std::pair<std::string_view, std::string_view>, 61> static_table = {{
+	{":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+	{":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+	{":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+	{"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""}, {"access-control-allow-origin", ""},
+	{"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""}, {"content-disposition", ""},
+	{"content-encoding", ""}, {"content-language", ""}, {"content-length", ""}, {"content-location", ""}, {"content-range", ""},
+	{"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""}, {"expect", ""},
+	{"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+	{"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+	{"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+	{"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+	{"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+	{"www-authenticate", ""}
+}};
+
+// Table entries are counted with 32 bytes of overhead.
+static constexpr size_t entry_overhead = 32;
+
+/**
+ * Read integer with prefix bits in the first byte.
+ * @param block    Header block.
+ * @param position Read position, moved past the integer.
+ * @param prefix   Prefix bits.
+ * @param value    Receives the integer.
+ * @return false when integer is truncated or too large.
+ */
+static bool readInteger(std::string_view block, size_t &position, const unsigned int prefix, uint64_t &value) {
+	if (position >= block.length()) return false;
+
+	uint64_t max = (1u << prefix) - 1;
+	value = static_cast<uint8_t>(block[position++]) & max;
+	if (value < max) return true;
+
+	for (unsigned int shift = 0; position < block.length() && shift <= 28; shift += 7) {
+		uint8_t byte = block[position++];
+		value += uint64_t(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Write integer with prefix bits in the first byte.
+ * @param block  Header block.
+ * @param flags  Bits of the first byte above the prefix.
+ * @param prefix Prefix bits.
+ * @param value  Integer.
+ */
+static void writeInteger(std::string &block, const uint8_t flags, const unsigned int prefix, uint64_t value) {
+	uint64_t max = (1u << prefix) - 1;
+
+	if (value < max) {
+		block.push_back(static_cast<char>(flags | value));
+		return;
+	}
+
+	block.push_back(static_cast<char>(flags | max));
+	value -= max;
+
+	while (value >= 128) {
+		block.push_back(static_cast<char>(0x80 | (value & 0x7f)));
+		value >>= 7;
+	}
+
+	block.push_back(static_cast<char>(value));
+}
+
+// Node of the Huffman decoding tree, leaves have a symbol.
+struct HuffmanNode {
+	int16_t next[2] = {-1, -1};
+	int16_t symbol  = -1;
+};
+
+/**
+ * Get Huffman decoding tree, built on first use.
+ */
+static const std::vector<HuffmanNode> &huffmanTree() {
+	static const std::vector<HuffmanNode> tree = [] {
+		std::vector<HuffmanNode> tree(1);
+
+		for (int16_t symbol = 0; symbol < 257; symbol++) {
+			size_t node = 0;
+
+			for (int bit = huffman_lengths[symbol] - 1; bit >= 0; bit--) {
+				int side = (huffman_codes[symbol] >> bit) & 1;
+
+				if (tree[node].next[side] == -1) {
+					tree[node].next[side] = static_cast<int16_t>(tree.size());
+					tree.emplace_back();
+				}
+
+				node = tree[node].next[side];
+			}
+
+			tree[node].symbol = symbol;
+		}
+
+		return tree;
+	}();
+
+	return tree;
+}
+
+/**
+ * Decode Huffman coded string.
+ * @param coded Coded bytes.
+ * @param value Receives decoded string.
+ * @return false when code is invalid or padding is not a prefix of end of string.
+ */
+static bool decodeHuffman(std::string_view coded, std::string &value) {
+	const std::vector<HuffmanNode> &tree = huffmanTree();
+	value.clear();
+	value.reserve(coded.length() * 8 / 5);
+
+	size_t node = 0;
+	unsigned int depth = 0;
+	bool ones = true;
+
+	for (unsigned char byte : coded) {
+		for (int bit = 7; bit >= 0; bit--) {
+			int side = (byte >> bit) & 1;
+			if (tree[node].next[side] == -1) return false;
+
+			node  = tree[node].next[side];
+			ones  = ones && side;
+			depth++;
+
+			if (tree[node].symbol == 256) return false;
+
+			if (tree[node].symbol != -1) {
+				value.push_back(static_cast<char>(tree[node].symbol));
+				node  = 0;
+				depth = 0;
+				ones  = true;
+			}
+		}
+	}
+
+	// Padding is shorter than a byte and made of the most significant bits of end of string.
+	return depth < 8 && ones;
+}
+
+/**
+ * Read string literal, Huffman coded or raw.
+ * @param block    Header block.
+ * @param position Read position, moved past the string.
+ * @param value    Receives the string.
+ * @return false when string is truncated or invalid.
+ */
+static bool readString(std::string_view block, size_t &position, std::string &value) {
+	if (position >= block.length()) return false;
+
+	bool huffman = block[position] & 0x80;
+	uint64_t length;
+
+	if (!readInteger(block, position, 7, length) || length > block.length() - position) return false;
+
+	std::string_view coded = block.substr(position, length);
+	position += length;
+
+	if (!huffman) {
+		value.assign(coded);
+		return true;
+	}
+
+	return decodeHuffman(coded, value);
+}
+
+/**
+ * Write string literal, Huffman coded when that is shorter.
+ * @param block Header block.
+ * @param value String.
+ */
+static void writeString(std::string &block, std::string_view value) {
+	size_t bits = 0;
+	for (unsigned char byte : value) {
+		bits += huffman_lengths[byte];
+	}
+
+	size_t length = (bits + 7) / 8;
+
+	if (length >= value.length()) {
+		writeInteger(block, 0x00, 7, value.length());
+		block.append(value);
+		return;
+	}
+
+	writeInteger(block, 0x80, 7, length);
+
+	uint64_t pending = 0;
+	unsigned int count = 0;
+
+	for (unsigned char byte : value) {
+		pending = (pending << huffman_lengths[byte]) | huffman_codes[byte];
+		count  += huffman_lengths[byte];
+
+		while (count >= 8) {
+			count -= 8;
+			block.push_back(static_cast<char>(pending >> count));
+		}
+	}
+
+	// Pad with the most significant bits of end of string.
+	if (count > 0) {
+		block.push_back(static_cast<char>((pending << (8 - count)) | (0xff >> count)));
+	}
+}
+
+/**
+ * Check wether header value differs between responses, so it is not worth a table entry.
+ * @param name Lowercase header name.
+ */
+static bool isVolatile(std::string_view name) {
+	return name == "content-length" || name == "date" || name == "etag" || name == "last-modified" || name == "location" || name == "retry-after";
+}
+
+/**
+ * Create compression context.
+ * @param capacity Dynamic table size, the most the other side allows.
+ */
+CoreHpack::CoreHpack(const size_t capacity):
+	capacity(capacity),
+	maximum(capacity) {
+}
+
+/**
+ * Decode header block into fields. The whole block is always decoded so the
+ * dynamic table stays in sync, fields over the limit are dropped.
+ * @param block     Complete header block.
+ * @param fields    Receives decoded fields in order.
+ * @param limit     Largest decoded size of all fields, counted like table entries.
+ * @param oversized Set when fields exceed the limit, fields are empty then.
+ * @return false on compression error, connection can not continue.
+ */
+bool CoreHpack::decode(std::string_view block, std::vector<Field> &fields, const size_t limit, bool &oversized) {
+	size_t position = 0;
+	size_t total    = 0;
+	oversized = false;
+
+	while (position < block.length()) {
+		uint8_t first = block[position];
+		uint64_t index;
+		std::string name, value;
+
+		// Indexed field.
+		if (first & 0x80) {
+			if (!readInteger(block, position, 7, index)) return false;
+
+			const Field *field = this -> find(index);
+			if (!field) return false;
+
+			name  = field -> first;
+			value = field -> second;
+
+		// Dynamic table size update.
+		} else if ((first & 0xe0) == 0x20) {
+			if (!readInteger(block, position, 5, index) || index > this -> maximum) return false;
+
+			this -> capacity = index;
+			this -> evict(0);
+			continue;
+
+		// Literal with incremental indexing, without indexing or never indexed.
+		} else {
+			bool indexing = (first & 0xc0) == 0x40;
+			if (!readInteger(block, position, indexing ? 6 : 4, index)) return false;
+
+			if (index > 0) {
+				const Field *field = this -> find(index);
+				if (!field) return false;
+				name = field -> first;
+			} else if (!readString(block, position, name)) {
+				return false;
+			}
+
+			if (!readString(block, position, value)) return false;
+			if (indexing) this -> insert(name, value);
+		}
+
+		total += name.length() + value.length() + entry_overhead;
+		oversized = oversized || total > limit;
+
+		if (!oversized) {
+			fields.emplace_back(std::move(name), std::move(value));
+		}
+	}
+
+	if (oversized) fields.clear();
+	return true;
+}
+
+/**
+ * Append field to the header block. Repeated fields become a single index,
+ * values that change per response are sent literally and cookies are never indexed.
+ * @param block Header block.
+ * @param name  Lowercase header name.
+ * @param value Header value.
+ */
+void CoreHpack::encode(std::string &block, std::string_view name, std::string_view value) {
+	// Smaller table allowed by the other side is announced at the start of the next block.
+	if (this -> resized) {
+		writeInteger(block, 0x20, 5, this -> capacity);
+		this -> resized = false;
+	}
+
+	bool matched = false;
+	size_t index = this -> search(name, value, matched);
+
+	if (matched) {
+		writeInteger(block, 0x80, 7, index);
+		return;
+	}
+
+	bool never    = name == "set-cookie";
+	bool indexing = !never && !isVolatile(name);
+
+	if (indexing) {
+		writeInteger(block, 0x40, 6, index);
+	} else {
+		writeInteger(block, never ? 0x10 : 0x00, 4, index);
+	}
+
+	if (index == 0) writeString(block, name);
+	writeString(block, value);
+
+	if (indexing) this -> insert(name, value);
+}
+
+/**
+ * Apply table size the other side allows, larger sizes than the current one are not used.
+ * @param capacity Table size from SETTINGS_HEADER_TABLE_SIZE.
+ */
+void CoreHpack::resize(const size_t capacity) {
+	size_t size = std::min(capacity, this -> maximum);
+	if (size == this -> capacity) return;
+
+	this -> capacity = size;
+	this -> resized  = true;
+	this -> evict(0);
+}
+
+/**
+ * Get field of static or dynamic table.
+ * @param index Index, static table first.
+ * @return field or nullptr when index is out of range.
+ */
+const CoreHpack::Field *CoreHpack::find(const size_t index) const {
+	static const std::vector<Field> fields = [] {
+		std::vector<Field> fields;
+		for (const auto &[name, value] : static_table) fields.emplace_back(name, value);
+		return fields;
+	}();
+
+	if (index == 0) return nullptr;
+	if (index <= fields.size()) return &fields[index - 1];
+	if (index - fields.size() <= this -> table.size()) return &this -> table[index - fields.size() - 1];
+
+	return nullptr;
+}
+
+/**
+ * Find index of field, or of its name when the value does not match.
+ * @param name    Header name.
+ * @param value   Header value.
+ * @param matched Set when name and value match.
+ * @return index or 0 when name is not in the tables.
+ */
+size_t CoreHpack::search(std::string_view name, std::string_view value, bool &matched) const {
+	size_t named = 0;
+
+	for (size_t i = 0; i < static_table.size(); i++) {
+		if (static_table[i].first != name) continue;
+
+		if (static_table[i].second == value) {
+			matched = true;
+			return i + 1;
+		}
+
+		if (named == 0) named = i + 1;
+	}
+
+	for (size_t i = 0; i < this -> table.size(); i++) {
+		if (this -> table[i].first != name) continue;
+
+		if (this -> table[i].second == value) {
+			matched = true;
+			return static_table.size() + i + 1;
+		}
+
+		if (named == 0) named = static_table.size() + i + 1;
+	}
+
+	return named;
+}
+
+/**
+ * Add field to the dynamic table, evicting the oldest entries. Fields larger
+ * than the table empty it.
+ * @param name  Header name.
+ * @param value Header value.
+ */
+void CoreHpack::insert(std::string_view name, std::string_view value) {
+	size_t size = name.length() + value.length() + entry_overhead;
+
+	if (size > this -> capacity) {
+		this -> table.clear();
+		this -> size = 0;
+		return;
+	}
+
+	this -> evict(size);
+	this -> table.emplace_front(name, value);
+	this -> size += size;
+}
+
+/**
+ * Evict oldest entries until room bytes fit into the table.
+ * @param room Bytes to make room for.
+ */
+void CoreHpack::evict(const size_t room) {
+	while (!this -> table.empty() && this -> size + room > this -> capacity) {
+		const Field &oldest = this -> table.back();
+		this -> size -= oldest.first.length() + oldest.second.length() + entry_overhead;
+		this -> table.pop_back();
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef CORE_HPACK_HPP
+#define CORE_HPACK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * HPACK header compression of one direction of an HTTP/2 connection: the
+ * receiving side decodes request header blocks, the sending side encodes
+ * response header blocks. Each side keeps its own dynamic table.
+ */
+class CoreHpack {
+	public:
+		using Field = std::pair<std::string, std::string>;
+
+		CoreHpack(const size_t capacity = 4096);
+
+		bool decode(std::string_view block, std::vector<Field> &fields, const size_t limit, bool &oversized);
+		void encode(std::string &block, std::string_view name, std::string_view value);
+		void resize(const size_t capacity);
+
+	private:
+		// Entries newest first, size counts 32 bytes of overhead per entry.
+		std::deque<Field> table;
+		size_t size = 0;
+		size_t capacity;
+
+		// Largest capacity the other side allows, and a size update to announce.
+		size_t maximum;
+		bool resized = false;
+
+		const Field *find(const size_t index) const;
+		size_t search(std::string_view name, std::string_view value, bool &matched) const;
+		void insert(std::string_view name, std::string_view value);
+		void evict(const size_t room);
+};
+
+#endif
@@ -0,0 +1,901 @@
+#include <core/http2/http2.hpp>
+
+#include <algorithm>
+#include <cctype>
+
+/**
+ * Read big-endian number.
+ * @param bytes    Bytes.
+ * @param position Position of the number.
+ * @param length   Length of the number in bytes.
+ */
+static uint32_t readNumber(std::string_view bytes, const size_t position, const size_t length) {
+	uint32_t value = 0;
+
+	for (size_t i = 0; i < length; i++) {
+		value = (value << 8) | static_cast<uint8_t>(bytes[position + i]);
+	}
+
+	return value;
+}
+
+/**
+ * Append big-endian number.
+ * @param bytes  Bytes.
+ * @param value  Number.
+ * @param length Length of the number in bytes.
+ */
+static void appendNumber(std::string &bytes, const uint32_t value, const size_t length) {
+	for (size_t i = length; i-- > 0;) {
+		bytes.push_back(static_cast<char>(value >> (i * 8)));
+	}
+}
+
+/**
+ * Decode base64url without padding, as HTTP2-Settings is sent.
+ * @param text    Encoded text.
+ * @param decoded Receives bytes.
+ * @return false when text is not base64url.
+ */
+static bool decodeBase64(std::string_view text, std::string &decoded) {
+	uint32_t bits  = 0;
+	unsigned int count = 0;
+
+	for (char c : text) {
+		uint32_t value;
+
+		if (c >= 'A' && c <= 'Z') value = c - 'A';
+		else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') value = c - '0' + 52;
+		else if (c == '-' || c == '+') value = 62;
+		else if (c == '_' || c == '/') value = 63;
+		else if (c == '=') break;
+		else return false;
+
+		bits   = (bits << 6) | value;
+		count += 6;
+
+		if (count >= 8) {
+			count -= 8;
+			decoded.push_back(static_cast<char>(bits >> count));
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Check wether rebuilt request line and fields stay intact: names are
+ * lowercase and nothing contains line breaks.
+ * @param name  Field name.
+ * @param value Field value.
+ */
+static bool isValidField(std::string_view name, std::string_view value) {
+	if (name.empty()) return false;
+
+	for (size_t i = 0; i < name.length(); i++) {
+		char c = name[i];
+		if ((c >= 'A' && c <= 'Z') || c == '\r' || c == '\n' || c == '\0' || c == ' ' || (c == ':' && i > 0)) return false;
+	}
+
+	return value.find_first_of(std::string_view("\r\n\0", 3)) == std::string_view::npos;
+}
+
+/**
+ * Trim spaces from both ends of view.
+ * @param value View to trim.
+ */
+static std::string_view trim(std::string_view value) {
+	while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) value.remove_prefix(1);
+	while (!value.empty() && (value.back()  == ' ' || value.back()  == '\t')) value.remove_suffix(1);
+	return value;
+}
+
+/**
+ * Start connection, server settings and a larger connection window are sent first.
+ * @param options Server options, header and body limits apply to every stream.
+ */
+CoreHttp2::CoreHttp2(const CoreOptions &options):
+	options(options) {
+		std::string settings;
+		appendNumber(settings, 3, 2);
+		appendNumber(settings, streams_max, 4);
+		appendNumber(settings, 4, 2);
+		appendNumber(settings, window_size, 4);
+		appendNumber(settings, 6, 2);
+		appendNumber(settings, options.max_header_size, 4);
+		this -> frame(Settings, 0, 0, settings);
+
+		std::string increment;
+		appendNumber(increment, window_size - 65535, 4);
+		this -> frame(WindowUpdate, 0, 0, increment);
+}
+
+/**
+ * Producers of open response streams find the client gone.
+ */
+CoreHttp2::~CoreHttp2() {
+	for (auto &[id, stream] : this -> streams) {
+		if (stream -> response) stream -> response -> close();
+	}
+}
+
+/**
+ * Check wether input starts with the client preface, or with as much of it as arrived.
+ * @param input Received bytes.
+ */
+bool CoreHttp2::isPreface(std::string_view input) {
+	return !input.empty() && input.substr(0, preface.length()) == preface.substr(0, std::min(input.length(), preface.length()));
+}
+
+/**
+ * Handle every complete frame of the input.
+ * @param input Received bytes.
+ * @param ready Receives ids of streams whose request is complete.
+ * @return bytes used, incomplete frames are left for later.
+ */
+size_t CoreHttp2::receive(std::string_view input, std::vector<uint32_t> &ready) {
+	size_t position = 0;
+	size_t consumed = 0;
+
+	if (this -> failed) return input.length();
+
+	if (!this -> prefaced) {
+		if (!input.empty() && !isPreface(input)) {
+			this -> error(ProtocolError);
+			return input.length();
+		}
+
+		if (input.length() < preface.length()) return 0;
+
+		position = preface.length();
+		this -> prefaced = true;
+	}
+
+	while (!this -> failed && input.length() - position >= frame_header) {
+		size_t length = readNumber(input, position, 3);
+		Type type     = static_cast<Type>(input[position + 3]);
+		uint8_t flags = input[position + 4];
+		uint32_t id   = readNumber(input, position + 5, 4) & 0x7fffffff;
+
+		if (length > frame_max) {
+			this -> error(FrameSizeError);
+			break;
+		}
+
+		if (input.length() - position - frame_header < length) break;
+
+		std::string_view payload = input.substr(position + frame_header, length);
+		position += frame_header + length;
+
+		// Header block continues only with CONTINUATION frames of its stream.
+		if ((this -> continued != 0) != (type == Continuation) || (this -> continued && id != this -> continued)) {
+			this -> error(ProtocolError);
+			break;
+		}
+
+		switch (type) {
+			case Data:
+				consumed += length;
+				this -> data(id, flags, payload, ready);
+				break;
+
+			case Headers:
+				this -> headers(id, flags, payload, ready);
+				break;
+
+			case Continuation:
+				this -> block.append(payload);
+
+				// Compressed block may not grow much larger than the decoded fields it carries.
+				if (this -> block.length() > this -> options.max_header_size * 2 + frame_max) {
+					this -> error(EnhanceYourCalm);
+				} else if (flags & end_headers) {
+					this -> open(id, this -> continued_end, ready);
+				}
+
+				break;
+
+			case Reset:
+				if (length != 4 || id == 0) {
+					this -> error(length != 4 ? FrameSizeError : ProtocolError);
+				} else {
+					this -> erase(id);
+				}
+
+				break;
+
+			case Settings:
+				if (id != 0 || (!(flags & ack) && length % 6 != 0)) {
+					this -> error(id != 0 ? ProtocolError : FrameSizeError);
+				} else if (!(flags & ack) && this -> settings(payload)) {
+					this -> frame(Settings, ack, 0, std::string_view());
+				}
+
+				break;
+
+			case PushPromise:
+				this -> error(ProtocolError);
+				break;
+
+			case Ping:
+				if (length != 8 || id != 0) {
+					this -> error(length != 8 ? FrameSizeError : ProtocolError);
+				} else if (!(flags & ack)) {
+					this -> frame(Ping, ack, 0, payload);
+				}
+
+				break;
+
+			// Client opens no more streams, connection closes once the open ones are answered.
+			case Goaway:
+				this -> leaving = true;
+				break;
+
+			case WindowUpdate: {
+				if (length != 4) {
+					this -> error(FrameSizeError);
+					break;
+				}
+
+				int64_t increment = readNumber(payload, 0, 4) & 0x7fffffff;
+
+				if (id == 0) {
+					if (increment == 0 || this -> window + increment > window_max) {
+						this -> error(increment == 0 ? ProtocolError : FlowControlError);
+					} else {
+						this -> window += increment;
+					}
+				} else if (Stream *stream = this -> find(id)) {
+					if (increment == 0 || stream -> window + increment > window_max) {
+						this -> reset(id, increment == 0 ? ProtocolError : FlowControlError);
+					} else {
+						stream -> window += increment;
+					}
+				}
+
+				break;
+			}
+
+			// Priorities and unknown frames are ignored.
+			default:
+				break;
+		}
+	}
+
+	// Received data is given back right away, bodies are limited by max_body_size instead.
+	if (consumed > 0 && !this -> failed) {
+		std::string increment;
+		appendNumber(increment, consumed, 4);
+		this -> frame(WindowUpdate, 0, 0, increment);
+	}
+
+	return this -> failed ? input.length() : position;
+}
+
+/**
+ * Continue HTTP/1.1 request that asked to upgrade, it becomes stream 1 and is
+ * answered over HTTP/2 once the client sent its preface.
+ * @param request  Request line and headers.
+ * @param settings HTTP2-Settings header value.
+ * @return stream of the request, nullptr when settings are invalid.
+ */
+CoreHttp2::Stream *CoreHttp2::upgrade(std::string_view request, std::string_view settings) {
+	std::string payload;
+	if (!decodeBase64(settings, payload) || payload.length() % 6 != 0 || !this -> settings(payload)) return nullptr;
+
+	auto stream = std::make_unique<Stream>();
+	stream -> id       = 1;
+	stream -> window   = this -> initial;
+	stream -> received = true;
+	stream -> output.defer();
+
+	// Request line keeps method and target, version tells routes the response goes out as HTTP/2.
+	size_t line    = request.find('\n');
+	if (line != std::string_view::npos && line > 0 && request[line - 1] == '\r') line--;
+	size_t version = request.rfind(' ', line);
+	if (line == std::string_view::npos || version == std::string_view::npos) return nullptr;
+
+	stream -> request.append(request.substr(0, version)).append(" HTTP/2").append(request.substr(line));
+	this -> last = 1;
+
+	Stream &opened = *stream;
+	this -> streams.emplace(1, std::move(stream));
+	return &opened;
+}
+
+/**
+ * Mark stream as handled on another thread, it stays until the route returns.
+ * @param stream Stream.
+ */
+void CoreHttp2::run(Stream &stream) {
+	stream.running = true;
+	this -> running++;
+}
+
+/**
+ * Route returned, response is sent with the next writes. Streams reset
+ * meanwhile are dropped.
+ * @param stream   Stream, invalid after the call when it was reset.
+ * @param response Response stream left open by the route or nullptr.
+ */
+void CoreHttp2::answer(Stream &stream, std::shared_ptr<CoreStream> response) {
+	if (stream.running) {
+		stream.running = false;
+		this -> running--;
+	}
+
+	stream.answered = true;
+	stream.response = std::move(response);
+
+	if (stream.reset) {
+		this -> erase(stream.id);
+	}
+}
+
+/**
+ * Find open stream.
+ * @param id Stream id.
+ * @return stream or nullptr when it is closed.
+ */
+CoreHttp2::Stream *CoreHttp2::find(const uint32_t id) {
+	auto found = this -> streams.find(id);
+	return found != this -> streams.end() ? found -> second.get() : nullptr;
+}
+
+/**
+ * Queue pending frames to the connection output: control frames, headers of
+ * answered streams and as much response data as windows allow.
+ * @param output Connection output.
+ * @param room   Wether output has room for response data.
+ * @return true when more data could be sent once output was written.
+ */
+bool CoreHttp2::write(CoreOutput &output, const bool room) {
+	size_t budget = room ? write_budget : 0;
+	std::vector<uint32_t> finished;
+
+	for (auto &[id, stream] : this -> streams) {
+		if (stream -> reset) {
+			finished.push_back(id);
+			continue;
+		}
+
+		if (!stream -> answered) continue;
+
+		bool done = !stream -> headers && this -> respond(*stream);
+
+		if (!done && !stream -> reset && stream -> headers && budget > 0) {
+			done = this -> send(*stream, budget);
+		}
+
+		if (done) {
+			finished.push_back(id);
+		}
+	}
+
+	for (uint32_t id : finished) {
+		Stream &stream = *this -> streams[id];
+
+		// Client may stop sending a body that is no longer needed.
+		if (!stream.reset && !stream.received) {
+			this -> reset(id, NoError);
+		}
+
+		this -> erase(id);
+	}
+
+	output.append(this -> frames);
+	this -> frames.clear();
+
+	return room && budget == 0;
+}
+
+/**
+ * Send GOAWAY, streams opened later are ignored and the connection closes
+ * once the open ones are answered.
+ */
+void CoreHttp2::shutdown() {
+	if (this -> goaway) return;
+
+	std::string payload;
+	appendNumber(payload, this -> last, 4);
+	appendNumber(payload, NoError, 4);
+	this -> frame(Goaway, 0, 0, payload);
+
+	this -> goaway  = true;
+	this -> leaving = true;
+}
+
+/**
+ * Check wether connection has to close: after a connection error or after
+ * GOAWAY once every stream was answered.
+ */
+bool CoreHttp2::isClosed() const {
+	return this -> failed || (this -> leaving && this -> streams.empty());
+}
+
+/**
+ * Check wether no stream is open.
+ */
+bool CoreHttp2::isIdle() const {
+	return this -> streams.empty();
+}
+
+/**
+ * Check wether a route runs or a response is being sent.
+ */
+bool CoreHttp2::isActive() const {
+	for (const auto &[id, stream] : this -> streams) {
+		if (stream -> running || stream -> answered) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Check wether routes of streams run on other threads.
+ */
+bool CoreHttp2::isRunning() const {
+	return this -> running > 0;
+}
+
+/**
+ * Queue frame.
+ * @param type    Frame type.
+ * @param flags   Frame flags.
+ * @param stream  Stream id, 0 for the connection.
+ * @param payload Frame payload.
+ */
+void CoreHttp2::frame(const Type type, const uint8_t flags, const uint32_t stream, std::string_view payload) {
+	appendNumber(this -> frames, payload.length(), 3);
+	this -> frames.push_back(static_cast<char>(type));
+	this -> frames.push_back(static_cast<char>(flags));
+	appendNumber(this -> frames, stream, 4);
+	this -> frames.append(payload);
+}
+
+/**
+ * Fail connection with GOAWAY, nothing more is received.
+ * @param code Error code.
+ */
+void CoreHttp2::error(const Error code) {
+	if (this -> failed) return;
+
+	std::string payload;
+	appendNumber(payload, this -> last, 4);
+	appendNumber(payload, code, 4);
+	this -> frame(Goaway, 0, 0, payload);
+
+	this -> failed  = true;
+	this -> leaving = true;
+	this -> goaway  = true;
+}
+
+/**
+ * Reset stream, its response is not sent.
+ * @param stream Stream id.
+ * @param code   Error code.
+ */
+void CoreHttp2::reset(const uint32_t stream, const Error code) {
+	std::string payload;
+	appendNumber(payload, code, 4);
+	this -> frame(Reset, 0, stream, payload);
+
+	if (Stream *found = this -> find(stream)) {
+		found -> reset = true;
+	}
+}
+
+/**
+ * Forget stream, streams with a running route are dropped once it returns.
+ * @param stream Stream id.
+ */
+void CoreHttp2::erase(const uint32_t stream) {
+	auto found = this -> streams.find(stream);
+	if (found == this -> streams.end()) return;
+
+	if (found -> second -> response) {
+		found -> second -> response -> close();
+	}
+
+	if (found -> second -> running) {
+		found -> second -> reset = true;
+		return;
+	}
+
+	this -> streams.erase(found);
+}
+
+/**
+ * Apply client settings.
+ * @param payload Settings, 6 bytes each.
+ * @return false when a setting is invalid and connection failed.
+ */
+bool CoreHttp2::settings(std::string_view payload) {
+	for (size_t position = 0; position + 6 <= payload.length(); position += 6) {
+		uint32_t id    = readNumber(payload, position, 2);
+		uint32_t value = readNumber(payload, position + 2, 4);
+
+		switch (id) {
+			// Header table size.
+			case 1:
+				this -> encoder.resize(value);
+				break;
+
+			// Enable push.
+			case 2:
+				if (value > 1) {
+					this -> error(ProtocolError);
+					return false;
+				}
+
+				break;
+
+			// Initial window size, the change applies to every open stream.
+			case 4:
+				if (value > window_max) {
+					this -> error(FlowControlError);
+					return false;
+				}
+
+				for (auto &[stream, state] : this -> streams) {
+					state -> window += int64_t(value) - this -> initial;
+				}
+
+				this -> initial = value;
+				break;
+
+			// Max frame size, larger frames than four times the default are not needed.
+			case 5:
+				if (value < frame_max || value > 16777215) {
+					this -> error(ProtocolError);
+					return false;
+				}
+
+				this -> frame_size = std::min<size_t>(value, frame_max * 4);
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Start header block of HEADERS frame, padding and priority are dropped.
+ * @param id      Stream id.
+ * @param flags   Frame flags.
+ * @param payload Frame payload.
+ * @param ready   Receives id of stream whose request is complete.
+ */
+void CoreHttp2::headers(const uint32_t id, const uint8_t flags, std::string_view payload, std::vector<uint32_t> &ready) {
+	size_t position = 0;
+	size_t padding  = 0;
+
+	if (flags & padded) {
+		if (payload.empty()) {
+			this -> error(ProtocolError);
+			return;
+		}
+
+		padding  = static_cast<uint8_t>(payload[0]);
+		position = 1;
+	}
+
+	if (flags & prioritized) {
+		position += 5;
+	}
+
+	if (id == 0 || position + padding > payload.length()) {
+		this -> error(ProtocolError);
+		return;
+	}
+
+	this -> block.assign(payload.substr(position, payload.length() - position - padding));
+	this -> continued_end = flags & end_stream;
+
+	if (flags & end_headers) {
+		this -> open(id, this -> continued_end, ready);
+	} else {
+		this -> continued = id;
+	}
+}
+
+/**
+ * Append DATA payload to the request body of its stream.
+ * @param id      Stream id.
+ * @param flags   Frame flags.
+ * @param payload Frame payload.
+ * @param ready   Receives id of stream whose request is complete.
+ */
+void CoreHttp2::data(const uint32_t id, const uint8_t flags, std::string_view payload, std::vector<uint32_t> &ready) {
+	if (flags & padded) {
+		size_t padding = payload.empty() ? 0 : static_cast<uint8_t>(payload[0]);
+
+		if (payload.empty() || padding + 1 > payload.length()) {
+			this -> error(ProtocolError);
+			return;
+		}
+
+		payload = payload.substr(1, payload.length() - 1 - padding);
+	}
+
+	if (id == 0 || (id > this -> last && !this -> leaving)) {
+		this -> error(ProtocolError);
+		return;
+	}
+
+	// Data of closed streams and of requests that are already answered is dropped.
+	Stream *stream = this -> find(id);
+	if (!stream || stream -> received) return;
+
+	if (flags & end_stream) {
+		stream -> received = true;
+	}
+
+	if (stream -> status) return;
+
+	stream -> length += payload.length();
+
+	if (stream -> length > this -> options.max_body_size) {
+		stream -> status = 413;
+		ready.push_back(id);
+		return;
+	}
+
+	stream -> request.append(payload);
+
+	if (stream -> received) {
+		ready.push_back(id);
+
+	// Stream window is given back while more of the body is expected.
+	} else if (!payload.empty()) {
+		std::string increment;
+		appendNumber(increment, payload.length(), 4);
+		this -> frame(WindowUpdate, 0, id, increment);
+	}
+}
+
+/**
+ * Decode complete header block and open its stream, or end the request of
+ * its stream when the block carries trailers.
+ * @param id    Stream id.
+ * @param end   Wether request has no body.
+ * @param ready Receives id of stream whose request is complete.
+ */
+void CoreHttp2::open(const uint32_t id, const bool end, std::vector<uint32_t> &ready) {
+	std::vector<CoreHpack::Field> fields;
+	bool oversized = false;
+
+	this -> continued = 0;
+
+	// Every block is decoded so the dynamic table stays in sync with the client.
+	if (!this -> decoder.decode(this -> block, fields, this -> options.max_header_size, oversized)) {
+		this -> error(CompressionError);
+		return;
+	}
+
+	this -> block.clear();
+
+	// Trailers end the request body, their fields are not used.
+	if (Stream *stream = this -> find(id)) {
+		if (!end) {
+			this -> reset(id, ProtocolError);
+			return;
+		}
+
+		if (!stream -> received && !stream -> status) {
+			ready.push_back(id);
+		}
+
+		stream -> received = true;
+		return;
+	}
+
+	if (id % 2 == 0) {
+		this -> error(ProtocolError);
+		return;
+	}
+
+	// Streams answered and closed before, and streams after GOAWAY are ignored.
+	if (id <= this -> last || this -> leaving) return;
+	this -> last = id;
+
+	if (this -> streams.size() >= streams_max) {
+		this -> reset(id, RefusedStream);
+		return;
+	}
+
+	auto stream = std::make_unique<Stream>();
+	stream -> id       = id;
+	stream -> window   = this -> initial;
+	stream -> received = end;
+	stream -> output.defer();
+
+	if (oversized) {
+		stream -> status = 431;
+	} else if (!this -> rebuild(*stream, fields)) {
+		this -> reset(id, ProtocolError);
+		return;
+	}
+
+	if (stream -> status || end) {
+		ready.push_back(id);
+	}
+
+	this -> streams.emplace(id, std::move(stream));
+}
+
+/**
+ * Rebuild text request from header fields, the body is appended as it arrives.
+ * Cookie fields are joined again, the authority becomes the Host header.
+ * @param stream Stream.
+ * @param fields Decoded fields.
+ * @return false when request is malformed.
+ */
+bool CoreHttp2::rebuild(Stream &stream, const std::vector<CoreHpack::Field> &fields) {
+	std::string_view method, path, authority;
+	bool regular = false;
+
+	for (const auto &[name, value] : fields) {
+		if (!isValidField(name, value)) return false;
+
+		// Pseudo-header fields come first.
+		if (name[0] == ':') {
+			if (regular) return false;
+
+			if (name == ":method") method = value;
+			else if (name == ":path") path = value;
+			else if (name == ":authority") authority = value;
+			else if (name != ":scheme") return false;
+
+			continue;
+		}
+
+		regular = true;
+
+		// Connection specific fields do not exist in HTTP/2.
+		if (name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "transfer-encoding" || name == "upgrade") return false;
+		if (name == "te" && value != "trailers") return false;
+	}
+
+	if (method.empty() || path.empty() || path.find(' ') != std::string_view::npos) return false;
+
+	std::string &request = stream.request;
+	std::string cookie;
+
+	request.append(method).append(" ").append(path).append(" HTTP/2\r\n");
+	if (!authority.empty()) request.append("host: ").append(authority).append("\r\n");
+
+	for (const auto &[name, value] : fields) {
+		if (name[0] == ':' || (name == "host" && !authority.empty())) continue;
+
+		if (name == "cookie") {
+			if (!cookie.empty()) cookie.append("; ");
+			cookie.append(value);
+			continue;
+		}
+
+		request.append(name).append(": ").append(value).append("\r\n");
+	}
+
+	if (!cookie.empty()) request.append("cookie: ").append(cookie).append("\r\n");
+	request.append("\r\n");
+
+	return true;
+}
+
+/**
+ * Turn head of the written response into a HEADERS frame, connection
+ * specific fields are left out.
+ * @param stream Answered stream.
+ * @return true when response has no content and stream ended with the headers.
+ */
+bool CoreHttp2::respond(Stream &stream) {
+	std::string head;
+	size_t end;
+
+	while ((end = head.find("\r\n\r\n")) == std::string::npos) {
+		if (stream.output.empty() || head.length() > this -> options.max_header_size * 4 || !stream.output.read(head, 4096)) {
+			this -> reset(stream.id, InternalError);
+			return false;
+		}
+	}
+
+	stream.data.assign(head, end + 4);
+	head.resize(end + 2);
+
+	std::string_view lines = head;
+	size_t line = lines.find("\r\n");
+	std::string_view status = lines.substr(0, line);
+	status = status.substr(std::min(status.find(' ') + 1, status.length()), 3);
+	lines.remove_prefix(line + 2);
+
+	std::string block;
+	std::string name;
+	this -> encoder.encode(block, ":status", status);
+
+	while (!lines.empty()) {
+		line = lines.find("\r\n");
+		std::string_view field = lines.substr(0, line);
+		lines.remove_prefix(line + 2);
+
+		size_t colon = field.find(':');
+		if (colon == std::string_view::npos) continue;
+
+		name.assign(trim(field.substr(0, colon)));
+		std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+
+		if (name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "transfer-encoding" || name == "upgrade") continue;
+		this -> encoder.encode(block, name, trim(field.substr(colon + 1)));
+	}
+
+	stream.headers = true;
+	bool complete  = stream.data.empty() && this -> isComplete(stream);
+
+	// Blocks larger than a frame continue in CONTINUATION frames.
+	std::string_view rest = block;
+	bool first = true;
+
+	do {
+		std::string_view part = rest.substr(0, this -> frame_size);
+		rest.remove_prefix(part.length());
+
+		uint8_t flags = (rest.empty() ? end_headers : 0) | (first && complete ? end_stream : 0);
+		this -> frame(first ? Headers : Continuation, flags, stream.id, part);
+		first = false;
+	} while (!rest.empty());
+
+	return complete;
+}
+
+/**
+ * Send response data within the stream and connection windows.
+ * @param stream Stream with headers sent.
+ * @param budget Data bytes left for this write, reduced by the sent data.
+ * @return true when the response ended.
+ */
+bool CoreHttp2::send(Stream &stream, size_t &budget) {
+	while (true) {
+		if (stream.data.empty() && !stream.output.empty() && !stream.output.read(stream.data, this -> frame_size)) {
+			this -> reset(stream.id, InternalError);
+			return false;
+		}
+
+		bool complete = this -> isComplete(stream);
+
+		// Response stream ended after its last data was sent.
+		if (stream.data.empty()) {
+			if (complete) this -> frame(Data, end_stream, stream.id, std::string_view());
+			return complete;
+		}
+
+		int64_t size = std::min<int64_t>({int64_t(stream.data.length()), stream.window, this -> window, int64_t(budget), int64_t(this -> frame_size)});
+		if (size <= 0) return false;
+
+		bool last = complete && size_t(size) == stream.data.length();
+		this -> frame(Data, last ? end_stream : 0, stream.id, std::string_view(stream.data).substr(0, size));
+
+		stream.data.erase(0, size);
+		stream.window  -= size;
+		this -> window -= size;
+		budget         -= size;
+
+		if (last) return true;
+	}
+}
+
+/**
+ * Take data of the response stream and check wether all of the response is read.
+ * @param stream Answered stream.
+ * @return true when nothing more will be written to output.
+ */
+bool CoreHttp2::isComplete(Stream &stream) {
+	if (stream.response && !stream.ended) {
+		stream.ended = stream.response -> take(stream.output);
+	}
+
+	return stream.output.empty() && (!stream.response || stream.ended);
+}
@@ -0,0 +1,159 @@
+#ifndef CORE_HTTP2_HPP
+#define CORE_HTTP2_HPP
+
+#include <core/http2/hpack.hpp>
+#include <core/output/output.hpp>
+#include <core/stream/stream.hpp>
+#include <core/server/options.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * HTTP/2 connection without TLS, started by the client preface or by upgrading
+ * an HTTP/1.1 request. Requests of multiplexed streams are rebuilt as text
+ * requests for the router, responses routes write are turned into HEADERS
+ * and DATA frames within the flow control windows of the client.
+ */
+class CoreHttp2 {
+	public:
+		static constexpr std::string_view preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+		// Request stream, its route writes the response to output.
+		struct Stream {
+			uint32_t id = 0;
+			std::string request;
+			CoreOutput output;
+
+			// Response stream left open by the route, ended once all its data was taken.
+			std::shared_ptr<CoreStream> response;
+			bool ended = false;
+
+			// Status to answer with instead of routing the request, for example 413.
+			unsigned int status = 0;
+			size_t length = 0;
+
+			// Response bytes read from output but not sent yet, and the send window.
+			std::string data;
+			int64_t window = 0;
+
+			bool received = false;
+			bool running  = false;
+			bool answered = false;
+			bool headers  = false;
+			bool reset    = false;
+
+			// Request was charged to the rate limit before the connection upgraded.
+			bool rated = false;
+		};
+
+		CoreHttp2(const CoreOptions &options);
+		CoreHttp2(const CoreHttp2&) = delete;
+		CoreHttp2 &operator=(const CoreHttp2&) = delete;
+		~CoreHttp2();
+
+		size_t receive(std::string_view input, std::vector<uint32_t> &ready);
+		Stream *upgrade(std::string_view request, std::string_view settings);
+		void run(Stream &stream);
+		void answer(Stream &stream, std::shared_ptr<CoreStream> response);
+		Stream *find(const uint32_t id);
+		bool write(CoreOutput &output, const bool room);
+		void shutdown();
+
+		bool isClosed() const;
+		bool isIdle() const;
+		bool isActive() const;
+		bool isRunning() const;
+
+		static bool isPreface(std::string_view input);
+
+	private:
+		enum Type : uint8_t {
+			Data = 0,
+			Headers,
+			Priority,
+			Reset,
+			Settings,
+			PushPromise,
+			Ping,
+			Goaway,
+			WindowUpdate,
+			Continuation
+		};
+
+		enum Error : uint32_t {
+			NoError = 0,
+			ProtocolError,
+			InternalError,
+			FlowControlError,
+			SettingsTimeout,
+			StreamClosed,
+			FrameSizeError,
+			RefusedStream,
+			Cancel,
+			CompressionError,
+			ConnectError,
+			EnhanceYourCalm
+		};
+
+		static constexpr uint8_t end_stream  = 0x1;
+		static constexpr uint8_t ack         = 0x1;
+		static constexpr uint8_t end_headers = 0x4;
+		static constexpr uint8_t padded      = 0x8;
+		static constexpr uint8_t prioritized = 0x20;
+
+		static constexpr size_t frame_header   = 9;
+		static constexpr size_t frame_max      = 16384;
+		static constexpr int64_t window_max    = 2147483647;
+		static constexpr int64_t window_size   = 1048576;
+		static constexpr uint32_t streams_max  = 128;
+
+		// Response data framed by one write, files are read in parts of this.
+		static constexpr size_t write_budget = 262144;
+
+		const CoreOptions &options;
+		CoreHpack decoder;
+		CoreHpack encoder;
+		std::map<uint32_t, std::unique_ptr<Stream>> streams;
+
+		// Frames waiting for the next write.
+		std::string frames;
+
+		// Connection state, last client stream and header block being received.
+		bool prefaced = false;
+		bool failed   = false;
+		bool leaving  = false;
+		bool goaway   = false;
+		uint32_t last = 0;
+		uint32_t running = 0;
+		uint32_t continued = 0;
+		bool continued_end = false;
+		std::string block;
+
+		// Send windows and largest frame the client accepts.
+		int64_t window  = 65535;
+		int64_t initial = 65535;
+		size_t frame_size = frame_max;
+
+		void frame(const Type type, const uint8_t flags, const uint32_t stream, std::string_view payload);
+		void error(const Error code);
+		void reset(const uint32_t stream, const Error code);
+		void erase(const uint32_t stream);
+
+		bool settings(std::string_view payload);
+		void headers(const uint32_t id, const uint8_t flags, std::string_view payload, std::vector<uint32_t> &ready);
+		void data(const uint32_t id, const uint8_t flags, std::string_view payload, std::vector<uint32_t> &ready);
+		void open(const uint32_t id, const bool end, std::vector<uint32_t> &ready);
+		bool rebuild(Stream &stream, const std::vector<CoreHpack::Field> &fields);
+
+		bool respond(Stream &stream);
+		bool send(Stream &stream, size_t &budget);
+		bool isComplete(Stream &stream);
+};
+
+#endif
@@ -0,0 +1,94 @@
+#include <core/limits/limits.hpp>
+
+#include <netinet/in.h>
+#include <cstring>
+
+/**
+ * Create connection caps, 0 leaves a cap out.
+ * @param total       Open connections of the server.
+ * @param per_address Open connections of one client address.
+ */
+CoreLimits::CoreLimits(const size_t total, const size_t per_address):
+	total(total), per_address(per_address) {
+}
+
+/**
+ * Get address of peer.
+ * @param peer Peer from accept.
+ * @return address, IPv4 mapped into IPv6.
+ */
+CoreLimits::Address CoreLimits::address(const sockaddr_storage &peer) {
+	Address address = {};
+
+	if (peer.ss_family == AF_INET) {
+		const sockaddr_in &ipv4 = reinterpret_cast<const sockaddr_in&>(peer);
+		address[10] = 0xff;
+		address[11] = 0xff;
+		memcpy(address.data() + 12, &ipv4.sin_addr, 4);
+
+	} else if (peer.ss_family == AF_INET6) {
+		const sockaddr_in6 &ipv6 = reinterpret_cast<const sockaddr_in6&>(peer);
+		memcpy(address.data(), &ipv6.sin6_addr, 16);
+	}
+
+	return address;
+}
+
+/**
+ * Admit new connection and count it, admitted connections are released on close.
+ * @param peer    Peer from accept.
+ * @param address Receives address to release.
+ * @return 0 when admitted, otherwise status to reject with: 503 when server is full, 429 when address is.
+ */
+unsigned int CoreLimits::admit(const sockaddr_storage &peer, Address &address) {
+	if (this -> open.fetch_add(1, std::memory_order_relaxed) >= this -> total && this -> total > 0) {
+		this -> open.fetch_sub(1, std::memory_order_relaxed);
+		return 503;
+	}
+
+	address = CoreLimits::address(peer);
+	Shard &shard = this -> shards[Hash()(address) % shard_count];
+
+	std::lock_guard<std::mutex> lock(shard.mutex);
+	size_t &count = shard.counts[address];
+
+	if (this -> per_address > 0 && count >= this -> per_address) {
+		this -> open.fetch_sub(1, std::memory_order_relaxed);
+		return 429;
+	}
+
+	count++;
+	return 0;
+}
+
+/**
+ * Release closed connection of address.
+ * @param address Address from admit.
+ */
+void CoreLimits::release(const Address &address) {
+	Shard &shard = this -> shards[Hash()(address) % shard_count];
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+
+		auto found = shard.counts.find(address);
+		if (found != shard.counts.end() && --found -> second == 0) {
+			shard.counts.erase(found);
+		}
+	}
+
+	this -> open.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * Hash address bytes with FNV-1a.
+ * @param address Address.
+ */
+size_t CoreLimits::Hash::operator()(const Address &address) const {
+	uint64_t hash = 1469598103934665603ull;
+
+	for (uint8_t byte : address) {
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+
+	return hash;
+}
@@ -0,0 +1,47 @@
+#ifndef CORE_LIMITS_HPP
+#define CORE_LIMITS_HPP
+
+#include <sys/socket.h>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Connection caps shared by every worker, in total and per client address.
+ * Per address counts live in mutex-guarded shards only touched on accept and close.
+ */
+class CoreLimits {
+	public:
+		// Client address, IPv4 addresses are kept IPv4-mapped.
+		using Address = std::array<uint8_t, 16>;
+
+		CoreLimits(const size_t total, const size_t per_address);
+
+		unsigned int admit(const sockaddr_storage &peer, Address &address);
+		void release(const Address &address);
+
+		static Address address(const sockaddr_storage &peer);
+
+	private:
+		static constexpr size_t shard_count = 64;
+
+		struct Hash {
+			size_t operator()(const Address &address) const;
+		};
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::unordered_map<Address, size_t, Hash> counts;
+		};
+
+		const size_t total;
+		const size_t per_address;
+		std::atomic<size_t> open = 0;
+		std::array<Shard, shard_count> shards;
+};
+
+#endif
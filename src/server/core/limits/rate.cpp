@@ -0,0 +1,254 @@
+#include <core/limits/rate.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+
+/**
+ * Mix bits of value, the finalizer of splitmix64.
+ * @param value Value.
+ */
+static uint64_t mix(uint64_t value) {
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+	return value ^ (value >> 31);
+}
+
+/**
+ * Pack bucket state.
+ * @param time   Milliseconds of the last update.
+ * @param tokens Thousandths of a request left.
+ */
+static uint64_t pack(const uint32_t time, const uint64_t tokens) {
+	return static_cast<uint64_t>(time) << 32 | static_cast<uint32_t>(tokens);
+}
+
+/**
+ * Create empty table, no request is limited until a limit is set.
+ * @param capacity Buckets kept at most, rounded up to a power of two.
+ */
+CoreRateLimit::CoreRateLimit(const size_t capacity):
+	cells(std::bit_ceil(std::max(capacity / cell_slots, shard_count))),
+	table(std::make_unique<Cell[]>(cells)) {
+}
+
+/**
+ * Limit requests of every client address.
+ * @param rate  Requests per second.
+ * @param burst Requests allowed at once after being idle.
+ */
+void CoreRateLimit::limit(const unsigned int rate, const unsigned int burst) {
+	if (rate == 0) {
+		throw std::runtime_error("Error: Rate limit needs a rate above 0.");
+	}
+
+	// Bucket state keeps tokens in 32 bits.
+	this -> rules[0] = {rate, std::clamp<uint64_t>(burst, 1, UINT32_MAX / cost) * cost};
+	this -> idle_ms  = std::max<uint64_t>(this -> idle_ms, this -> rules[0].burst / rate + 1);
+}
+
+/**
+ * Limit requests of every client address to the route, on top of the limit of every request.
+ * @param url   Route url, static text with ':param' segments and '*tail' as routes are added.
+ * @param rate  Requests per second.
+ * @param burst Requests allowed at once after being idle.
+ */
+void CoreRateLimit::limit(std::string_view url, const unsigned int rate, const unsigned int burst) {
+	if (rate == 0) {
+		throw std::runtime_error("Error: Rate limit of " + std::string(url) + " needs a rate above 0.");
+	}
+
+	this -> routes.insert(url, this -> rules.size());
+	this -> rules.push_back({rate, std::clamp<uint64_t>(burst, 1, UINT32_MAX / cost) * cost});
+	this -> idle_ms = std::max<uint64_t>(this -> idle_ms, this -> rules.back().burst / rate + 1);
+	this -> routed  = true;
+}
+
+/**
+ * Take a token from the buckets of client address for the request.
+ * Only the request line is read, the rest of the request is left unparsed.
+ * @param address Client address.
+ * @param head    Request line and headers.
+ * @return 0 when allowed, otherwise seconds until the client may retry.
+ */
+unsigned int CoreRateLimit::take(const CoreLimits::Address &address, std::string_view head) {
+	uint32_t now = this -> now();
+
+	// One caller per interval sweeps the next shard.
+	uint32_t swept = this -> swept.load(std::memory_order_relaxed);
+	if (static_cast<int32_t>(now - swept) >= sweep_ms && this -> swept.compare_exchange_strong(swept, now, std::memory_order_relaxed)) {
+		this -> sweep(now);
+	}
+
+	if (this -> rules[0].rate > 0) {
+		unsigned int retry = this -> take(address, 0, now);
+		if (retry) return retry;
+	}
+
+	if (!this -> routed) return 0;
+
+	// Captured params are not used, they stay on the stack.
+	std::array<std::byte, 512> buffer;
+	std::pmr::monotonic_buffer_resource resource(buffer.data(), buffer.size());
+	CoreTrie::Params params(&resource);
+
+	size_t rule = this -> routes.find(CoreRateLimit::path(head), params);
+	return rule != CoreTrie::none ? this -> take(address, rule, now) : 0;
+}
+
+/**
+ * Get path of request target without parsing the request.
+ * @param head Request line and headers.
+ * @return path, empty when request line has none.
+ */
+std::string_view CoreRateLimit::path(std::string_view head) {
+	size_t start = head.find(' ');
+	if (start == std::string_view::npos) return std::string_view();
+
+	size_t end = head.find_first_of(" ?#\r\n", ++start);
+	std::string_view target = head.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+
+	// Absolute form, path starts after the authority.
+	if (!target.starts_with('/')) {
+		size_t scheme = target.find("://");
+		size_t slash  = scheme == std::string_view::npos ? std::string_view::npos : target.find('/', scheme + 3);
+		target = slash == std::string_view::npos ? std::string_view() : target.substr(slash);
+	}
+
+	return target;
+}
+
+/**
+ * Get milliseconds since the table was created, wrapping after 49 days.
+ */
+uint32_t CoreRateLimit::now() const {
+	return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this -> started).count());
+}
+
+/**
+ * Take a token from the bucket of client address under rule, the bucket is added when missing.
+ * Full cells give the slot idle longest to the new bucket.
+ * @param address Client address.
+ * @param rule    Rule index.
+ * @param now     Milliseconds now.
+ * @return 0 when allowed, otherwise seconds until the client may retry.
+ */
+unsigned int CoreRateLimit::take(const CoreLimits::Address &address, const size_t rule, const uint32_t now) {
+	const uint64_t key = CoreRateLimit::key(address, rule);
+	const size_t per_shard = this -> cells / shard_count;
+	Cell &cell = this -> table[(key >> 58) * per_shard + (key & (per_shard - 1))];
+
+	for (size_t slot = 0; slot < cell_slots; slot++) {
+		if (cell.keys[slot].load(std::memory_order_acquire) == key) {
+			return this -> consume(cell.states[slot], this -> rules[rule], now);
+		}
+	}
+
+	// New bucket starts full, with this request taken.
+	const uint64_t fresh = pack(now, this -> rules[rule].burst - cost);
+	size_t oldest = 0;
+	uint32_t age  = 0;
+
+	for (size_t slot = 0; slot < cell_slots; slot++) {
+		uint64_t used = cell.keys[slot].load(std::memory_order_acquire);
+
+		if (used == 0) {
+			if (cell.keys[slot].compare_exchange_strong(used, key, std::memory_order_acq_rel)) {
+				cell.states[slot].store(fresh, std::memory_order_release);
+				return 0;
+			}
+
+			// Slot was taken meanwhile, maybe by the same client.
+			if (used == key) return this -> consume(cell.states[slot], this -> rules[rule], now);
+		}
+
+		uint32_t idle = now - static_cast<uint32_t>(cell.states[slot].load(std::memory_order_relaxed) >> 32);
+		if (idle >= age) {
+			age    = idle;
+			oldest = slot;
+		}
+	}
+
+	uint64_t used = cell.keys[oldest].load(std::memory_order_acquire);
+	if (cell.keys[oldest].compare_exchange_strong(used, key, std::memory_order_acq_rel)) {
+		cell.states[oldest].store(fresh, std::memory_order_release);
+	}
+
+	return 0;
+}
+
+/**
+ * Refill bucket for the time passed and take a token from it.
+ * Refused requests leave the bucket untouched, floods cost no writes.
+ * @param state Bucket state.
+ * @param rule  Rule of the bucket.
+ * @param now   Milliseconds now.
+ * @return 0 when allowed, otherwise seconds until the client may retry.
+ */
+unsigned int CoreRateLimit::consume(std::atomic<uint64_t> &state, const Rule &rule, const uint32_t now) const {
+	uint64_t current = state.load(std::memory_order_acquire);
+
+	while (true) {
+		uint32_t time    = static_cast<uint32_t>(current >> 32);
+		int32_t elapsed  = static_cast<int32_t>(now - time);
+		uint64_t refill  = elapsed > 0 ? static_cast<uint64_t>(elapsed) * rule.rate : 0;
+		uint64_t tokens  = std::min(rule.burst, static_cast<uint32_t>(current) + refill);
+
+		if (tokens < cost) {
+			uint64_t wait_ms = (cost - tokens + rule.rate - 1) / rule.rate;
+			return static_cast<unsigned int>((wait_ms + 999) / 1000);
+		}
+
+		// Another thread may have stored a later time already.
+		if (state.compare_exchange_weak(current, pack(elapsed > 0 ? now : time, tokens - cost), std::memory_order_acq_rel, std::memory_order_acquire)) {
+			return 0;
+		}
+	}
+}
+
+/**
+ * Evict buckets of the next shard that are full again, a batch of cells at a time.
+ * @param now Milliseconds now.
+ */
+void CoreRateLimit::sweep(const uint32_t now) {
+	const size_t per_shard = this -> cells / shard_count;
+	const size_t first = (this -> shard.fetch_add(1, std::memory_order_relaxed) % shard_count) * per_shard;
+
+	for (size_t index = first; index < first + per_shard; index++) {
+		Cell &cell = this -> table[index];
+
+		for (size_t slot = 0; slot < cell_slots; slot++) {
+			uint64_t used = cell.keys[slot].load(std::memory_order_relaxed);
+			if (used == 0) continue;
+
+			uint32_t idle = now - static_cast<uint32_t>(cell.states[slot].load(std::memory_order_relaxed) >> 32);
+			if (idle >= this -> idle_ms) {
+				cell.keys[slot].compare_exchange_strong(used, 0, std::memory_order_relaxed);
+			}
+		}
+	}
+}
+
+/**
+ * Get bucket key of address under rule, never 0. IPv6 clients are limited
+ * by their /64 prefix, one host usually gets a whole prefix to pick from.
+ * @param address Client address, IPv4 addresses IPv4-mapped.
+ * @param rule    Rule index.
+ */
+uint64_t CoreRateLimit::key(const CoreLimits::Address &address, const size_t rule) {
+	static constexpr uint8_t mapped[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff, 0xff};
+
+	uint64_t high = 0;
+	uint64_t low  = 0;
+	memcpy(&high, address.data(), 8);
+
+	if (memcmp(address.data(), mapped, sizeof(mapped)) == 0) {
+		memcpy(&low, address.data() + 8, 8);
+	}
+
+	uint64_t key = mix(high ^ mix(low ^ (rule + 1) * 0x9e3779b97f4a7c15ull));
+	return key ? key : 1;
+}
@@ -0,0 +1,74 @@
+#ifndef CORE_RATE_HPP
+#define CORE_RATE_HPP
+
+#include <core/limits/limits.hpp>
+#include <core/router/trie.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+/**
+ * Request rate limits with token buckets per client address, and per client
+ * address and route for routes with a limit of their own. Buckets live in a
+ * fixed table of 64 byte cells, updated with atomic compare and swap only.
+ * Under races a client may get a token more or less, no caller ever waits.
+ * Buckets refilled in full are evicted one shard at a time as time passes.
+ */
+class CoreRateLimit {
+	public:
+		CoreRateLimit(const size_t capacity = 65536);
+
+		void limit(const unsigned int rate, const unsigned int burst);
+		void limit(std::string_view url, const unsigned int rate, const unsigned int burst);
+
+		unsigned int take(const CoreLimits::Address &address, std::string_view head);
+
+		static std::string_view path(std::string_view head);
+
+	private:
+		static constexpr size_t shard_count = 64;
+		static constexpr size_t cell_slots  = 4;
+		static constexpr uint64_t cost      = 1000;
+		static constexpr int64_t sweep_ms   = 100;
+
+		// Tokens refilled per millisecond and bucket size, in thousandths of a request.
+		struct Rule {
+			uint64_t rate  = 0;
+			uint64_t burst = 0;
+		};
+
+		// Slots of one cache line, keys hash address and rule, states pack time and tokens.
+		struct alignas(64) Cell {
+			std::array<std::atomic<uint64_t>, cell_slots> keys;
+			std::array<std::atomic<uint64_t>, cell_slots> states;
+		};
+
+		const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+		size_t cells = 0;
+		std::unique_ptr<Cell[]> table;
+
+		// Rule 0 limits every request of an address, route rules are found by trie.
+		std::vector<Rule> rules = {Rule()};
+		CoreTrie routes;
+		bool routed = false;
+
+		// Buckets idle this long are full again, sweeps take turns by shard.
+		uint32_t idle_ms = 0;
+		std::atomic<uint32_t> swept = 0;
+		std::atomic<size_t> shard = 0;
+
+		uint32_t now() const;
+		unsigned int take(const CoreLimits::Address &address, const size_t rule, const uint32_t now);
+		unsigned int consume(std::atomic<uint64_t> &state, const Rule &rule, const uint32_t now) const;
+		void sweep(const uint32_t now);
+
+		static uint64_t key(const CoreLimits::Address &address, const size_t rule);
+};
+
+#endif
@@ -0,0 +1,265 @@
+#include <core/metrics/metrics.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+/**
+ * Record one duration.
+ * @param nanoseconds Duration.
+ */
+void CoreHistogram::record(const uint64_t nanoseconds) {
+	this -> counts[CoreHistogram::index(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+	this -> sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+/**
+ * Get bucket of duration, small values have a bucket each.
+ * @param nanoseconds Duration.
+ * @return bucket index.
+ */
+size_t CoreHistogram::index(const uint64_t nanoseconds) {
+	if (nanoseconds < linear) return nanoseconds;
+
+	size_t exponent = std::min<size_t>(std::bit_width(nanoseconds) - 1, 39);
+	size_t sub      = exponent == 39 && nanoseconds >> 40 ? (1 << sub_bits) - 1 : (nanoseconds >> (exponent - sub_bits)) & ((1 << sub_bits) - 1);
+
+	return linear + (exponent - sub_bits - 1) * (1 << sub_bits) + sub;
+}
+
+/**
+ * Get largest duration of bucket.
+ * @param index Bucket index.
+ * @return nanoseconds.
+ */
+uint64_t CoreHistogram::upper(const size_t index) {
+	if (index < linear) return index;
+
+	size_t exponent = (index - linear) / (1 << sub_bits) + sub_bits + 1;
+	size_t sub      = (index - linear) % (1 << sub_bits);
+
+	return (((1 << sub_bits) + sub + 1) << (exponent - sub_bits)) - 1;
+}
+
+/**
+ * Create metrics with a shard per core and the series of unmatched requests.
+ */
+CoreMetrics::CoreMetrics():
+	shard_count(std::clamp(std::thread::hardware_concurrency(), 1u, 16u)) {
+		this -> add("", "");
+}
+
+/**
+ * Add series of route, routes are added before the server starts.
+ * @param method Route method.
+ * @param route  Route url pattern.
+ * @return series index.
+ */
+size_t CoreMetrics::add(const std::string &method, const std::string &route) {
+	this -> series.push_back({method, route, std::make_unique<Shard[]>(this -> shard_count)});
+	return this -> series.size() - 1;
+}
+
+/**
+ * Get shard of the calling thread, threads are spread over shards in order they record first.
+ * @param series Series index.
+ */
+CoreMetrics::Shard &CoreMetrics::shard(const size_t series) {
+	static std::atomic<size_t> threads = 0;
+	thread_local size_t thread = threads.fetch_add(1, std::memory_order_relaxed);
+
+	return this -> series[series].shards[thread % this -> shard_count];
+}
+
+/**
+ * Record answered request.
+ * @param series      Series index.
+ * @param status      Response status code.
+ * @param nanoseconds Duration of every stage.
+ */
+void CoreMetrics::record(const size_t series, const unsigned int status, const std::array<uint64_t, Stages> &nanoseconds) {
+	Shard &shard = this -> shard(series);
+	shard.statuses[std::clamp(status / 100, 1u, 5u) - 1].fetch_add(1, std::memory_order_relaxed);
+
+	for (size_t stage = 0; stage < Stages; stage++) {
+		shard.stages[stage].record(nanoseconds[stage]);
+	}
+}
+
+/**
+ * Record request rejected before routing, for example 413 or 503.
+ * @param status Response status code.
+ */
+void CoreMetrics::reject(const unsigned int status) {
+	this -> rejected[std::clamp(status / 100, 1u, 5u) - 1].fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Count opened connection.
+ */
+void CoreMetrics::open() {
+	this -> connections.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Count closed connection.
+ */
+void CoreMetrics::close() {
+	this -> connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+/**
+ * Escape Prometheus label value.
+ * @param value Label value.
+ * @return escaped value.
+ */
+static std::string label(const std::string &value) {
+	std::string escaped;
+
+	for (char symbol : value) {
+		if (symbol == '\\' || symbol == '"') escaped.push_back('\\');
+		if (symbol == '\n') {
+			escaped.append("\\n");
+			continue;
+		}
+
+		escaped.push_back(symbol);
+	}
+
+	return escaped;
+}
+
+/**
+ * Append number in seconds.
+ * @param out         Output.
+ * @param nanoseconds Duration.
+ */
+static void seconds(std::string &out, const double nanoseconds) {
+	char number[32];
+	out.append(number, snprintf(number, sizeof(number), "%.9g", nanoseconds / 1e9));
+}
+
+/**
+ * Render every metric in Prometheus text format.
+ * @return exposition text.
+ */
+std::string CoreMetrics::render() const {
+	static const char *classes[] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+	static const char *stages[]  = {"parse", "route", "handler", "write"};
+	static const double bounds[] = {1e4, 2.5e4, 5e4, 1e5, 2.5e5, 5e5, 1e6, 2.5e6, 5e6, 1e7, 2.5e7, 5e7, 1e8, 2.5e8, 5e8, 1e9, 2.5e9, 5e9, 1e10};
+	static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+
+	std::string out;
+	std::string counts;
+	std::string durations;
+	std::string percentiles;
+
+	counts.append("# HELP core_requests_total Requests answered per route and status class.\n");
+	counts.append("# TYPE core_requests_total counter\n");
+	durations.append("# HELP core_request_stage_seconds Request time per route and stage.\n");
+	durations.append("# TYPE core_request_stage_seconds histogram\n");
+	percentiles.append("# HELP core_request_stage_quantile_seconds Request time quantiles per route and stage, within 12.5%.\n");
+	percentiles.append("# TYPE core_request_stage_quantile_seconds gauge\n");
+
+	std::vector<uint64_t> buckets(CoreHistogram::buckets);
+
+	for (const Series &series : this -> series) {
+		std::string labels = "method=\"" + label(series.method) + "\",route=\"" + label(series.route) + "\"";
+		uint64_t total = 0;
+
+		for (size_t status = 0; status < 5; status++) {
+			uint64_t count = 0;
+			for (size_t i = 0; i < this -> shard_count; i++) {
+				count += series.shards[i].statuses[status].load(std::memory_order_relaxed);
+			}
+
+			if (count == 0) continue;
+
+			counts.append("core_requests_total{").append(labels).append(",status=\"").append(classes[status]).append("\"} ");
+			counts.append(std::to_string(count)).append("\n");
+			total += count;
+		}
+
+		// Routes without requests have empty histograms.
+		if (total == 0) continue;
+
+		for (size_t stage = 0; stage < Stages; stage++) {
+			std::fill(buckets.begin(), buckets.end(), 0);
+			uint64_t sum   = 0;
+			uint64_t count = 0;
+
+			for (size_t i = 0; i < this -> shard_count; i++) {
+				const CoreHistogram &histogram = series.shards[i].stages[stage];
+				sum += histogram.sum.load(std::memory_order_relaxed);
+
+				for (size_t bucket = 0; bucket < CoreHistogram::buckets; bucket++) {
+					buckets[bucket] += histogram.counts[bucket].load(std::memory_order_relaxed);
+				}
+			}
+
+			for (uint64_t bucket : buckets) count += bucket;
+
+			std::string stage_labels = labels + ",stage=\"" + stages[stage] + "\"";
+
+			// Buckets are counted below the first bound their largest value fits.
+			uint64_t cumulative = 0;
+			size_t bucket = 0;
+
+			for (double bound : bounds) {
+				while (bucket < CoreHistogram::buckets && CoreHistogram::upper(bucket) <= bound) {
+					cumulative += buckets[bucket++];
+				}
+
+				durations.append("core_request_stage_seconds_bucket{").append(stage_labels).append(",le=\"");
+				seconds(durations, bound);
+				durations.append("\"} ").append(std::to_string(cumulative)).append("\n");
+			}
+
+			durations.append("core_request_stage_seconds_bucket{").append(stage_labels).append(",le=\"+Inf\"} ").append(std::to_string(count)).append("\n");
+			durations.append("core_request_stage_seconds_sum{").append(stage_labels).append("} ");
+			seconds(durations, sum);
+			durations.append("\ncore_request_stage_seconds_count{").append(stage_labels).append("} ").append(std::to_string(count)).append("\n");
+
+			// Quantiles from full bucket resolution.
+			for (double quantile : quantiles) {
+				uint64_t rank = static_cast<uint64_t>(quantile * count);
+				uint64_t seen = 0;
+				size_t found  = 0;
+
+				for (; found < CoreHistogram::buckets; found++) {
+					seen += buckets[found];
+					if (seen > rank) break;
+				}
+
+				char number[16];
+				percentiles.append("core_request_stage_quantile_seconds{").append(stage_labels).append(",quantile=\"");
+				percentiles.append(number, snprintf(number, sizeof(number), "%g", quantile)).append("\"} ");
+				seconds(percentiles, CoreHistogram::upper(std::min(found, CoreHistogram::buckets - 1)));
+				percentiles.append("\n");
+			}
+		}
+	}
+
+	out.append(counts).append(durations).append(percentiles);
+
+	out.append("# HELP core_rejected_total Requests rejected before routing per status class.\n");
+	out.append("# TYPE core_rejected_total counter\n");
+	for (size_t status = 0; status < 5; status++) {
+		uint64_t count = this -> rejected[status].load(std::memory_order_relaxed);
+		if (count > 0) out.append("core_rejected_total{status=\"").append(classes[status]).append("\"} ").append(std::to_string(count)).append("\n");
+	}
+
+	out.append("# HELP core_connections Open client connections.\n");
+	out.append("# TYPE core_connections gauge\n");
+	out.append("core_connections ").append(std::to_string(this -> connections.load(std::memory_order_relaxed))).append("\n");
+
+	if (this -> pool) {
+		out.append("# HELP core_pool_queue Requests waiting for a handler thread.\n");
+		out.append("# TYPE core_pool_queue gauge\n");
+		out.append("core_pool_queue ").append(std::to_string(this -> pool -> size())).append("\n");
+	}
+
+	return out;
+}
@@ -0,0 +1,90 @@
+#ifndef CORE_METRICS_HPP
+#define CORE_METRICS_HPP
+
+#include <core/pool/pool.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+/**
+ * Latency histogram with HDR-style log-linear buckets, every power of two
+ * is split into 8 sub-buckets so recorded values stay within 12.5%.
+ * Recording is a relaxed atomic increment.
+ */
+class CoreHistogram {
+	public:
+		static constexpr size_t sub_bits = 3;
+		static constexpr size_t linear   = 2 << sub_bits;
+		static constexpr size_t buckets  = linear + (40 - sub_bits - 1) * (1 << sub_bits);
+
+		void record(const uint64_t nanoseconds);
+
+		static size_t index(const uint64_t nanoseconds);
+		static uint64_t upper(const size_t index);
+
+	private:
+		std::array<std::atomic<uint64_t>, buckets> counts = {};
+		std::atomic<uint64_t> sum = 0;
+
+	friend class CoreMetrics;
+};
+
+/**
+ * Request counters and latency histograms per route, plus connection and
+ * queue gauges. Every route has one shard per core so threads recording
+ * at the same time rarely share cache lines, shards are summed on export.
+ */
+class CoreMetrics {
+	public:
+		// Measured request stages.
+		enum Stage { Parse, Route, Handler, Write, Stages };
+
+		// Counters of one route on one core.
+		struct alignas(64) Shard {
+			std::array<std::atomic<uint64_t>, 5> statuses = {};
+			std::array<CoreHistogram, Stages> stages;
+		};
+
+		// Counters of one route.
+		struct Series {
+			std::string method;
+			std::string route;
+			std::unique_ptr<Shard[]> shards;
+		};
+
+		CoreMetrics();
+
+		size_t add(const std::string &method, const std::string &route);
+		void record(const size_t series, const unsigned int status, const std::array<uint64_t, Stages> &nanoseconds);
+		void reject(const unsigned int status);
+
+		void open();
+		void close();
+
+		std::string render() const;
+
+		// Series of requests that matched no route.
+		static constexpr size_t unmatched = 0;
+
+	private:
+		const size_t shard_count;
+		std::deque<Series> series;
+
+		std::atomic<int64_t> connections = 0;
+		std::array<std::atomic<uint64_t>, 5> rejected = {};
+
+		// Handler pool of the server, queue depth is read on export.
+		const CorePool *pool = nullptr;
+
+		Shard &shard(const size_t series);
+
+	friend class CoreServer;
+};
+
+#endif
@@ -0,0 +1,40 @@
+#include <core/middleware/middleware.hpp>
+
+/**
+ * @param middleware Middleware the chain belongs to.
+ * @param layer      Index of the layer next runs.
+ * @param request    Request.
+ * @param response   Response.
+ * @param final      Runs the end of the chain.
+ * @param context    Passed to final.
+ */
+CoreMiddleware::Next::Next(const CoreMiddleware &middleware, const size_t layer, const Request &request, Response &response, const Final final, void *context):
+	middleware(middleware), layer(layer), request(request), response(response), final(final), context(context) {}
+
+/**
+ * Run the next layer, after the last one the end of the chain.
+ */
+void CoreMiddleware::Next::operator()() const {
+	if (this -> layer == this -> middleware.layers.size()) {
+		this -> final(this -> context, this -> request, this -> response);
+		return;
+	}
+
+	Next next(this -> middleware, this -> layer + 1, this -> request, this -> response, this -> final, this -> context);
+	this -> middleware.layers[this -> layer](this -> request, this -> response, next);
+}
+
+/**
+ * Add layer after the ones added so far.
+ * @param layer Called as layer(request, response, next).
+ */
+void CoreMiddleware::use(Layer layer) {
+	this -> layers.push_back(std::move(layer));
+}
+
+/**
+ * Check wether no layer was added.
+ */
+bool CoreMiddleware::isEmpty() const {
+	return this -> layers.empty();
+}
@@ -0,0 +1,112 @@
+#ifndef CORE_MIDDLEWARE_HPP
+#define CORE_MIDDLEWARE_HPP
+
+#include <core/headers/request.hpp>
+#include <core/headers/response.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Middleware chain composed at compile time, the last callable is the route
+ * handler and every one before it a layer called as layer(request, response, next).
+ * Calling next() runs the rest of the chain, a layer that responds itself
+ * skips it. Layers are stored by value and inlined into a single call.
+ *
+ * server.get("/account", CoreChain(requestId, authorize, [](const Request&, Response &response) { ... }));
+ */
+template <typename... Layers>
+class CoreChain {
+	static_assert(sizeof...(Layers) > 0, "Chain needs a route handler.");
+
+	public:
+		/**
+		 * @param layers Layers in the order they run, route handler last.
+		 */
+		explicit CoreChain(Layers... layers): layers(std::move(layers)...) {}
+
+		/**
+		 * Run the chain from its first layer.
+		 * @param request  Request.
+		 * @param response Response.
+		 */
+		void operator()(const Request &request, Response &response) {
+			this -> call<0>(request, response);
+		}
+
+	private:
+		std::tuple<Layers...> layers;
+
+		/**
+		 * Run layer and the rest of the chain it passes to.
+		 * @param request  Request.
+		 * @param response Response.
+		 */
+		template <size_t layer>
+		void call(const Request &request, Response &response) {
+			if constexpr (layer + 1 == sizeof...(Layers)) {
+				std::get<layer>(this -> layers)(request, response);
+			} else {
+				std::get<layer>(this -> layers)(request, response, [this, &request, &response] {
+					this -> call<layer + 1>(request, response);
+				});
+			}
+		}
+};
+
+/**
+ * Middleware registered at runtime, layers run in the order they were added
+ * around every routed request. Layers are called as layer(request, response, next),
+ * generic layers written for CoreChain work here too.
+ */
+class CoreMiddleware {
+	public:
+		// Rest of the chain, call it at most once and before the layer returns.
+		class Next {
+			public:
+				void operator()() const;
+
+			private:
+				using Final = void (*)(void *context, const Request &request, Response &response);
+
+				const CoreMiddleware &middleware;
+				const size_t layer;
+				const Request &request;
+				Response &response;
+				const Final final;
+				void *const context;
+
+				Next(const CoreMiddleware &middleware, const size_t layer, const Request &request, Response &response, const Final final, void *context);
+
+			friend class CoreMiddleware;
+		};
+
+		using Layer = std::function<void(const Request&, Response&, const Next&)>;
+
+		void use(Layer layer);
+		bool isEmpty() const;
+
+		/**
+		 * Run every layer and then final, unless a layer responds without calling next.
+		 * @param request  Request.
+		 * @param response Response.
+		 * @param final    Called as final(request, response) at the end of the chain.
+		 */
+		template <typename Final>
+		void run(const Request &request, Response &response, Final &&final) const {
+			Next::Final call = [](void *context, const Request &request, Response &response) {
+				(*static_cast<std::remove_reference_t<Final>*>(context))(request, response);
+			};
+
+			Next(*this, 0, request, response, call, const_cast<void*>(static_cast<const void*>(&final)))();
+		}
+
+	private:
+		std::vector<Layer> layers;
+};
+
+#endif
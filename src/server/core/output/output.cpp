@@ -0,0 +1,213 @@
+#include <core/output/output.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <algorithm>
+
+/**
+ * Close every queued file.
+ */
+CoreOutput::~CoreOutput() {
+	this -> clear();
+}
+
+/**
+ * Check wether anything is waiting to be written.
+ */
+bool CoreOutput::empty() const {
+	return this -> segments.empty();
+}
+
+/**
+ * Queue bytes, copied into the output.
+ * @param data Bytes to write.
+ */
+void CoreOutput::append(std::string_view data) {
+	if (data.empty()) return;
+
+	// Merge with previous bytes.
+	if (!this -> segments.empty() && this -> segments.back().file == -1) {
+		this -> segments.back().data.append(data);
+		return;
+	}
+
+	this -> segments.emplace_back();
+	this -> segments.back().data = data;
+}
+
+/**
+ * Queue file range to be sent with sendfile, file descriptor is duplicated.
+ * @param file   Open file.
+ * @param offset Range start.
+ * @param length Range length.
+ */
+void CoreOutput::appendFile(const int file, const off_t offset, const size_t length) {
+	if (length == 0) return;
+
+	Segment segment;
+	segment.file   = fcntl(file, F_DUPFD_CLOEXEC, 0);
+	segment.offset = offset;
+	segment.length = length;
+
+	this -> segments.push_back(std::move(segment));
+}
+
+/**
+ * Write as much as the socket accepts.
+ * @param connection Client connection.
+ * @return false when connection failed.
+ */
+bool CoreOutput::flush(const int connection) {
+	while (!this -> segments.empty()) {
+		Segment &segment = this -> segments.front();
+		ssize_t size;
+
+		if (segment.file == -1) {
+			size = ::send(connection, segment.data.data() + this -> written, segment.data.length() - this -> written, MSG_NOSIGNAL);
+		} else {
+			size = sendfile(connection, segment.file, &segment.offset, segment.length);
+		}
+
+		if (size == -1) {
+			if (errno == EINTR) continue;
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+
+		// File shrank while queued.
+		if (size == 0 && segment.file != -1) return false;
+
+		if (segment.file == -1) {
+			this -> written += size;
+			if (this -> written < segment.data.length()) continue;
+		} else {
+			segment.length -= size;
+			if (segment.length > 0) continue;
+			::close(segment.file);
+		}
+
+		this -> written = 0;
+		this -> segments.pop_front();
+	}
+
+	return true;
+}
+
+/**
+ * Move leading bytes out of the output, file ranges are read from their file.
+ * @param data  Receives bytes.
+ * @param limit Most bytes to move.
+ * @return false when a file could not be read.
+ */
+bool CoreOutput::read(std::string &data, size_t limit) {
+	while (limit > 0 && !this -> segments.empty()) {
+		Segment &segment = this -> segments.front();
+
+		if (segment.file == -1) {
+			size_t take = std::min(limit, segment.data.length() - this -> written);
+			data.append(segment.data, this -> written, take);
+			this -> written += take;
+			limit -= take;
+
+			if (this -> written < segment.data.length()) continue;
+		} else {
+			size_t start = data.length();
+			data.resize(start + std::min(limit, segment.length));
+
+			ssize_t size = pread(segment.file, data.data() + start, data.length() - start, segment.offset);
+
+			if (size == -1 && errno == EINTR) {
+				data.resize(start);
+				continue;
+			}
+
+			// File shrank while queued.
+			if (size <= 0) {
+				data.resize(start);
+				return false;
+			}
+
+			data.resize(start + size);
+			segment.offset += size;
+			segment.length -= size;
+			limit -= size;
+
+			if (segment.length > 0) continue;
+			::close(segment.file);
+		}
+
+		this -> written = 0;
+		this -> segments.pop_front();
+	}
+
+	return true;
+}
+
+/**
+ * Drop everything queued.
+ */
+void CoreOutput::clear() {
+	for (const Segment &segment : this -> segments) {
+		if (segment.file != -1) ::close(segment.file);
+	}
+
+	this -> segments.clear();
+	this -> written = 0;
+}
+
+/**
+ * Let responses queue everything here, owner submits output itself.
+ */
+void CoreOutput::defer() {
+	this -> deferred = true;
+}
+
+/**
+ * Check wether responses queue everything instead of writing it.
+ */
+bool CoreOutput::isDeferred() const {
+	return this -> deferred;
+}
+
+/**
+ * Describe leading queued bytes for a vectored write, file ranges are left out.
+ * Bytes stay valid until they are advanced over or more output is appended.
+ * @param parts    Receives buffers.
+ * @param count    Size of parts.
+ * @param complete Set when buffers hold all of the output.
+ * @return number of buffers, 0 when output is empty or starts with a file range.
+ */
+size_t CoreOutput::gather(iovec *parts, const size_t count, bool &complete) const {
+	size_t used = 0;
+
+	for (const Segment &segment : this -> segments) {
+		if (used == count || segment.file != -1) break;
+
+		size_t skip = used == 0 ? this -> written : 0;
+		parts[used++] = {const_cast<char*>(segment.data.data()) + skip, segment.data.length() - skip};
+	}
+
+	complete = used == this -> segments.size();
+	return used;
+}
+
+/**
+ * Drop bytes written by a vectored write of gathered buffers.
+ * @param size Written bytes.
+ */
+void CoreOutput::advance(size_t size) {
+	while (size > 0 && !this -> segments.empty() && this -> segments.front().file == -1) {
+		Segment &segment = this -> segments.front();
+		size_t take = std::min(size, segment.data.length() - this -> written);
+
+		this -> written += take;
+		size -= take;
+
+		if (this -> written == segment.data.length()) {
+			this -> written = 0;
+			this -> segments.pop_front();
+		}
+	}
+}
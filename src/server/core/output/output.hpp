@@ -0,0 +1,50 @@
+#ifndef CORE_OUTPUT_HPP
+#define CORE_OUTPUT_HPP
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+
+/**
+ * Connection output waiting for the socket to become writable. Keeps
+ * buffered bytes and file ranges in the order they were queued.
+ */
+class CoreOutput {
+	public:
+		CoreOutput() = default;
+		CoreOutput(const CoreOutput&) = delete;
+		CoreOutput &operator=(const CoreOutput&) = delete;
+		~CoreOutput();
+
+		bool empty() const;
+		void append(std::string_view data);
+		void appendFile(const int file, const off_t offset, const size_t length);
+
+		bool flush(const int connection);
+		bool read(std::string &data, size_t limit);
+		void clear();
+
+		// Output submitted by its owner instead of written by responses.
+		void defer();
+		bool isDeferred() const;
+		size_t gather(iovec *parts, const size_t count, bool &complete) const;
+		void advance(size_t size);
+
+	private:
+		// Bytes when file is -1, otherwise owned file range.
+		struct Segment {
+			std::string data;
+			int file      = -1;
+			off_t offset  = 0;
+			size_t length = 0;
+		};
+
+		std::deque<Segment> segments;
+		size_t written = 0;
+		bool deferred  = false;
+};
+
+#endif
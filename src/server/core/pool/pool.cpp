@@ -0,0 +1,128 @@
+#include <core/pool/pool.hpp>
+
+// Set on threads of every pool.
+static thread_local bool pooled = false;
+
+/**
+ * Start pool threads.
+ * @param threads  Number of handler threads.
+ * @param capacity Maximum number of queued tasks.
+ */
+CorePool::CorePool(const unsigned int threads, const size_t capacity):
+	capacity(capacity) {
+		for (unsigned int index = 0; index < threads; index++) {
+			this -> queues.push_back(std::make_unique<Queue>());
+		}
+
+		for (unsigned int index = 0; index < threads; index++) {
+			this -> threads.emplace_back(&CorePool::work, this, index);
+		}
+}
+
+/**
+ * Finish queued tasks and stop pool threads.
+ */
+CorePool::~CorePool() {
+	{
+		std::lock_guard<std::mutex> lock(this -> mutex);
+		this -> stopped = true;
+	}
+
+	this -> wake.notify_all();
+
+	for (auto &thread : this -> threads) {
+		thread.join();
+	}
+}
+
+/**
+ * Queue task for a pool thread.
+ * @param task Task to run.
+ * @return false when the queue is full and task was not accepted.
+ */
+bool CorePool::submit(std::function<void()> task) {
+	if (this -> queued.fetch_add(1) >= this -> capacity) {
+		this -> queued.fetch_sub(1);
+		return false;
+	}
+
+	// Spread tasks over thread queues, idle threads steal the rest.
+	Queue &queue = *this -> queues[this -> next.fetch_add(1, std::memory_order_relaxed) % this -> queues.size()];
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(this -> mutex);
+	}
+
+	this -> wake.notify_one();
+	return true;
+}
+
+/**
+ * Get number of queued tasks.
+ */
+size_t CorePool::size() const {
+	return this -> queued.load(std::memory_order_relaxed);
+}
+
+/**
+ * Take task from own queue front or steal from back of another queue.
+ * @param index Thread index.
+ * @param task  Taken task.
+ * @return true when task was taken.
+ */
+bool CorePool::take(const unsigned int index, std::function<void()> &task) {
+	for (size_t offset = 0; offset < this -> queues.size(); offset++) {
+		Queue &queue = *this -> queues[(index + offset) % this -> queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.tasks.empty()) continue;
+
+		if (offset == 0) {
+			task = std::move(queue.tasks.front());
+			queue.tasks.pop_front();
+		} else {
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+		}
+
+		this -> queued.fetch_sub(1);
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Pool thread loop.
+ * @param index Thread index.
+ */
+void CorePool::work(const unsigned int index) {
+	std::function<void()> task;
+	pooled = true;
+
+	while (true) {
+		if (this -> take(index, task)) {
+			task();
+			task = nullptr;
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this -> mutex);
+		this -> wake.wait(lock, [this] {
+			return this -> stopped || this -> queued.load() > 0;
+		});
+
+		if (this -> stopped && this -> queued.load() == 0) return;
+	}
+}
+
+/**
+ * Check wether the calling thread belongs to a pool, it may block without stalling a reactor.
+ */
+bool CorePool::isPoolThread() {
+	return pooled;
+}
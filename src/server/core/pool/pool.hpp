@@ -0,0 +1,49 @@
+#ifndef CORE_POOL_HPP
+#define CORE_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing handler pool with a bounded number of queued tasks. Every
+ * thread owns a queue and steals from the others when its own is empty.
+ */
+class CorePool {
+	public:
+		CorePool(const unsigned int threads, const size_t capacity);
+		~CorePool();
+
+		bool submit(std::function<void()> task);
+		size_t size() const;
+
+		static bool isPoolThread();
+
+	private:
+		struct Queue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+
+		const size_t capacity;
+		std::vector<std::unique_ptr<Queue>> queues;
+		std::vector<std::thread> threads;
+
+		std::atomic<size_t> queued   = 0;
+		std::atomic<unsigned int> next = 0;
+
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopped = false;
+
+		void work(const unsigned int index);
+		bool take(const unsigned int index, std::function<void()> &task);
+};
+
+#endif
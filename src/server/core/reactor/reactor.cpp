@@ -0,0 +1,1587 @@
+#include <core/reactor/reactor.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <strings.h>
+#include <algorithm>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+/**
+ * Switch socket to non-blocking mode.
+ * @param socket Socket to modify.
+ * @return false when the mode could not be changed.
+ */
+static bool setNonBlocking(const int socket) {
+	int flags = fcntl(socket, F_GETFL, 0);
+	return flags != -1 && fcntl(socket, F_SETFL, flags | O_NONBLOCK) != -1;
+}
+
+/**
+ * Create reactor for the listening server socket, on io_uring when options ask for it and the ring can be set up.
+ * @param router  Router to dispatch buffered requests to.
+ * @param server  Listening server socket.
+ * @param options Connection handling options.
+ * @param pool    Handler pool, handlers run on the reactor thread without one.
+ * @param stop    Event that starts draining once readable, -1 to run until failure.
+ * @param limits  Connection caps shared by every worker, nullptr for none.
+ * @param rates   Request rate limits shared by every worker, nullptr for none.
+ */
+CoreReactor::CoreReactor(CoreRouter &router, const int &server, const CoreOptions &options, CorePool *pool, const int stop, CoreLimits *limits, CoreRateLimit *rates):
+	router(router), server(server), options(options), pool(pool), stop(stop), limits(limits), rates(rates) {
+		this -> wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+		if (this -> wakeup == -1 || !setNonBlocking(this -> server)) {
+			perror("Unable to create reactor wakeup: ");
+			exit(EXIT_FAILURE);
+		}
+
+		if (this -> options.io_uring) {
+			this -> ring = std::make_unique<CoreRing>();
+
+			if (this -> ring -> isReady()) {
+				this -> ring -> accept(this -> server, tag(Accept));
+				this -> ring -> poll(this -> wakeup, POLLIN, true, tag(Wakeup));
+				if (this -> stop != -1) this -> ring -> poll(this -> stop, POLLIN, true, tag(Stop));
+
+				this -> accepting = true;
+				return;
+			}
+
+			perror("Unable to set up io_uring, using epoll: ");
+			this -> ring.reset();
+		}
+
+		this -> poll = epoll_create1(EPOLL_CLOEXEC);
+
+		if (this -> poll == -1) {
+			perror("Unable to create event loop: ");
+			exit(EXIT_FAILURE);
+		}
+
+		epoll_event event = {};
+		event.events  = EPOLLIN | EPOLLET;
+		event.data.fd = this -> server;
+
+		if (epoll_ctl(this -> poll, EPOLL_CTL_ADD, this -> server, &event) == -1) {
+			perror("Unable to watch server socket: ");
+			exit(EXIT_FAILURE);
+		}
+
+		event.events  = EPOLLIN | EPOLLET;
+		event.data.fd = this -> wakeup;
+
+		if (epoll_ctl(this -> poll, EPOLL_CTL_ADD, this -> wakeup, &event) == -1) {
+			perror("Unable to watch reactor wakeup: ");
+			exit(EXIT_FAILURE);
+		}
+
+		// Stop event is shared by every worker and never read, level-triggered so each one sees it.
+		event.events  = EPOLLIN;
+		event.data.fd = this -> stop;
+
+		if (this -> stop != -1 && epoll_ctl(this -> poll, EPOLL_CTL_ADD, this -> stop, &event) == -1) {
+			perror("Unable to watch stop event: ");
+			exit(EXIT_FAILURE);
+		}
+}
+
+/**
+ * Close every open connection and the event loop.
+ */
+CoreReactor::~CoreReactor() {
+	for (const auto &[connection, state] : this -> connections) {
+		if (state.stream) state.stream -> close();
+		if (state.limited) this -> limits -> release(state.address);
+
+		// Linked close owns the descriptor.
+		if (!state.linked) ::close(connection);
+
+		if (CoreMetrics *metrics = this -> router.getMetrics()) {
+			metrics -> close();
+		}
+	}
+
+	// Ring goes first, its pending operations still use buffers of the connections.
+	this -> ring.reset();
+
+	::close(this -> wakeup);
+	if (this -> poll != -1) ::close(this -> poll);
+}
+
+/**
+ * Run event loop until it is drained after stop or fails.
+ */
+int CoreReactor::run() {
+	if (this -> ring) {
+		return this -> cycle();
+	}
+
+	epoll_event events[events_max];
+
+	while (true) {
+		int count = epoll_wait(this -> poll, events, events_max, this -> draining || this -> backoff ? retry_ms : timer_ms);
+
+		if (count == -1) {
+			if (errno == EINTR) continue;
+
+			perror("Event loop failed: ");
+			return EXIT_FAILURE;
+		}
+
+		for (int i = 0; i < count; i++) {
+			// New connections on the listener.
+			if (events[i].data.fd == this -> server) {
+				this -> accept();
+
+			// Handlers finished on pool threads.
+			} else if (events[i].data.fd == this -> wakeup) {
+				this -> complete();
+
+			// Server stopped.
+			} else if (events[i].data.fd == this -> stop) {
+				this -> drain();
+
+			// Connection closed or failed.
+			} else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+				this -> close(events[i].data.fd);
+
+			} else {
+				// Connection writable again, send waiting output first.
+				if (events[i].events & EPOLLOUT) {
+					this -> flush(events[i].data.fd);
+				}
+
+				// Connection data available.
+				if (events[i].events & (EPOLLIN | EPOLLRDHUP)) {
+					this -> receive(events[i].data.fd);
+				}
+
+				this -> touch(events[i].data.fd);
+			}
+		}
+
+		// Accept connections that waited while descriptors ran out.
+		if (this -> backoff && !this -> draining && std::chrono::steady_clock::now() >= this -> retry) {
+			this -> accept();
+		}
+
+		this -> expire();
+
+		if (this -> draining && this -> drained()) {
+			return EXIT_SUCCESS;
+		}
+	}
+}
+
+/**
+ * Stop accepting, close idle connections and let the rest finish their requests.
+ */
+void CoreReactor::drain() {
+	if (this -> draining) return;
+
+	this -> draining = true;
+	this -> deadline = std::chrono::steady_clock::now() + std::chrono::seconds(this -> options.shutdown_timeout);
+
+	if (this -> ring) {
+		this -> ring -> cancel(tag(Stop), tag(Cancel));
+		if (this -> accepting) this -> ring -> cancel(tag(Accept), tag(Cancel));
+	} else {
+		epoll_ctl(this -> poll, EPOLL_CTL_DEL, this -> stop, nullptr);
+		epoll_ctl(this -> poll, EPOLL_CTL_DEL, this -> server, nullptr);
+	}
+
+	// Keep-alive connections between requests, HTTP/2 connections are sent GOAWAY and WebSockets close with 1001.
+	std::vector<int> idle;
+	std::vector<int> multiplexed;
+	std::vector<int> sockets;
+	for (const auto &[connection, state] : this -> connections) {
+		if (state.http2) {
+			multiplexed.push_back(connection);
+		} else if (state.websocket) {
+			sockets.push_back(connection);
+		} else if (!state.busy && !state.stream && !state.streaming && state.output.empty() && state.buffer.empty()) {
+			idle.push_back(connection);
+		}
+	}
+
+	for (int connection : idle) {
+		this -> close(connection);
+	}
+
+	for (int connection : multiplexed) {
+		this -> multiplex(connection, this -> connections.at(connection));
+	}
+
+	for (int connection : sockets) {
+		Connection &state = this -> connections.at(connection);
+		state.websocket -> close(1001);
+		this -> converse(connection, state);
+	}
+}
+
+/**
+ * Check wether draining finished, connections left at deadline are closed.
+ * Busy connections are waited for since their handlers still use the reactor.
+ * @return true when no connection is left.
+ */
+bool CoreReactor::drained() {
+	if (std::chrono::steady_clock::now() >= this -> deadline) {
+		std::vector<int> open;
+		for (const auto &[connection, state] : this -> connections) {
+			if (!state.busy && !(state.http2 && state.http2 -> isRunning())) open.push_back(connection);
+		}
+
+		for (int connection : open) {
+			this -> close(connection);
+		}
+	}
+
+	return this -> connections.empty();
+}
+
+/**
+ * Get deadline of the phase connection is in: writing output, receiving streamed
+ * body, receiving headers or waiting for the next request. Header deadline counts
+ * from the first byte of the request and is not extended by progress, so clients
+ * sending headers a byte at a time are closed in time. Small bodies parsed in
+ * place arrive within the header deadline.
+ * @param state Connection state.
+ * @return deadline tick, 0 while handler or response stream owns connection.
+ */
+uint64_t CoreReactor::expiry(const Connection &state) const {
+	auto after = [](const uint64_t from, const unsigned int seconds) -> uint64_t {
+		return seconds > 0 ? from + seconds * 1000 / CoreTimers::tick_ms : 0;
+	};
+
+	if (state.busy) return 0;
+	if (!state.output.empty()) return after(state.active, this -> options.write_timeout);
+
+	// WebSockets stay open until either side closes, a close sent has to be answered in time.
+	if (state.websocket) {
+		return state.websocket -> isOpen() ? 0 : after(state.active, this -> options.write_timeout);
+	}
+
+	// HTTP/2 waits for routes and response streams, then for request bodies or new streams.
+	if (state.http2) {
+		if (state.http2 -> isActive()) return 0;
+		return after(state.active, state.http2 -> isIdle() ? this -> options.keep_alive_timeout : this -> options.body_timeout);
+	}
+
+	if (state.stream) return 0;
+	if (state.streaming) return after(state.active, this -> options.body_timeout);
+	if (!state.buffer.empty()) return after(state.started, this -> options.header_timeout);
+
+	return after(state.active, this -> options.keep_alive_timeout);
+}
+
+/**
+ * Schedule timer for the connection deadline unless an earlier one is pending.
+ * Later deadlines are rescheduled once the earlier timer expires.
+ * @param connection Client connection.
+ */
+void CoreReactor::touch(const int connection) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end()) return;
+
+	Connection &state = found -> second;
+	uint64_t deadline = this -> expiry(state);
+
+	if (deadline == 0 || (state.scheduled != 0 && state.scheduled <= deadline)) return;
+	state.scheduled = this -> timers.schedule(connection, deadline);
+}
+
+/**
+ * Close connections past their deadline, incomplete HTTP/1 requests are answered with 408.
+ */
+void CoreReactor::expire() {
+	this -> expired.clear();
+	this -> timers.advance(CoreTimers::now(), this -> expired);
+
+	for (const auto &[connection, tick] : this -> expired) {
+		auto found = this -> connections.find(connection);
+
+		// Connection closed or timer replaced by an earlier one.
+		if (found == this -> connections.end() || found -> second.scheduled != tick) continue;
+
+		Connection &state = found -> second;
+		state.scheduled = 0;
+
+		// Progress moved deadline, or handler and stream own the connection.
+		uint64_t deadline = this -> expiry(state);
+		if (deadline == 0) continue;
+
+		if (deadline > this -> timers.current()) {
+			this -> touch(connection);
+			continue;
+		}
+
+		if (!state.http2 && !state.websocket && state.output.empty() && (state.streaming || !state.buffer.empty())) {
+			this -> router.reject(connection, 408, 0, &state.output);
+
+			// Ring closes the connection after the answer is sent.
+			if (this -> ring) {
+				state.closing = true;
+				this -> submit(connection, state);
+				if (state.released) continue;
+			}
+		}
+
+		this -> close(connection);
+	}
+}
+
+/**
+ * Accept every pending connection of the listener.
+ */
+void CoreReactor::accept() {
+	while (true) {
+		sockaddr_storage peer;
+		socklen_t peer_size = sizeof(peer);
+		int connection = accept4(this -> server, reinterpret_cast<sockaddr*>(&peer), &peer_size, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if (connection == -1) {
+			if (errno == EINTR || errno == ECONNABORTED) continue;
+
+			// Out of descriptors or memory, connections wait in the accept queue until retry.
+			if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+				if (!this -> backoff) perror("Accepting paused: ");
+
+				this -> backoff = std::min(this -> backoff ? this -> backoff * 2 : retry_ms / 10, backoff_ms);
+				this -> retry   = std::chrono::steady_clock::now() + std::chrono::milliseconds(this -> backoff);
+				return;
+			}
+
+			// Accept queue drained.
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				perror("Request failed: ");
+			}
+
+			this -> backoff = 0;
+			return;
+		}
+
+		this -> backoff = 0;
+		this -> open(connection, &peer);
+	}
+}
+
+/**
+ * Register accepted connection, connections over the limits are answered and closed.
+ * @param connection Accepted connection.
+ * @param peer       Client address, nullptr to look it up when limits need it.
+ */
+void CoreReactor::open(const int connection, const sockaddr_storage *peer) {
+	sockaddr_storage lookup = {};
+
+	if ((this -> limits || this -> rates) && !peer) {
+		socklen_t size = sizeof(lookup);
+		getpeername(connection, reinterpret_cast<sockaddr*>(&lookup), &size);
+		peer = &lookup;
+	}
+
+	// Server or client address full, answer without reading the request.
+	CoreLimits::Address address = {};
+	unsigned int status = this -> limits ? this -> limits -> admit(*peer, address) : 0;
+	if (!this -> limits && this -> rates) address = CoreLimits::address(*peer);
+
+	if (status) {
+		this -> router.reject(connection, status, 1, nullptr);
+
+		// Unread request would reset the connection before the client reads the answer.
+		char discard[4096];
+		while (::recv(connection, discard, sizeof(discard), MSG_DONTWAIT) > 0);
+
+		::close(connection);
+		return;
+	}
+
+	int conf = 1;
+	setsockopt(connection, SOL_TCP, TCP_NODELAY, &conf, sizeof(conf));
+
+	if (!this -> ring) {
+		epoll_event event = {};
+		event.events  = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		event.data.fd = connection;
+
+		if (epoll_ctl(this -> poll, EPOLL_CTL_ADD, connection, &event) == -1) {
+			perror("Unable to watch connection: ");
+			if (this -> limits) this -> limits -> release(address);
+			::close(connection);
+			return;
+		}
+	}
+
+	Connection &state = this -> connections[connection];
+	state.address = address;
+	state.limited = this -> limits != nullptr;
+
+	// Responses queue their output, it is sent with the next submission.
+	if (this -> ring) {
+		this -> generations = std::max<uint32_t>((this -> generations + 1) & 0xffffff, 1);
+		state.generation = this -> generations;
+		state.receiving  = true;
+		state.output.defer();
+		this -> ring -> receive(connection, tag(Receive, connection, state.generation));
+	}
+
+	if (CoreMetrics *metrics = this -> router.getMetrics()) {
+		metrics -> open();
+	}
+
+	this -> touch(connection);
+}
+
+/**
+ * Read everything available on the connection and dispatch complete requests.
+ * Reading pauses while the buffer is full and continues once requests made room.
+ * @param connection Client connection.
+ */
+void CoreReactor::receive(const int connection) {
+	if (this -> ring) {
+		this -> resume(connection);
+		return;
+	}
+
+	size_t limit = this -> options.max_header_size + this -> options.body_spill_size;
+
+	while (true) {
+		auto found = this -> connections.find(connection);
+		if (found == this -> connections.end()) return;
+
+		Connection &state = found -> second;
+
+		// Handler still parses the buffer, read once it finishes.
+		if (state.busy) return;
+
+		bool full = false;
+
+		// Edge-triggered, read until the socket is drained.
+		while (true) {
+			if (state.buffer.size() >= limit) {
+				full = true;
+				break;
+			}
+
+			// First bytes of the request start its header deadline.
+			bool empty = state.buffer.empty();
+			ssize_t size = state.buffer.receive(connection);
+
+			if (size > 0) {
+				if (empty) state.started = CoreTimers::now();
+				continue;
+
+			// Client closed its side, answer what is already buffered.
+			} else if (size == 0) {
+				state.eof = true;
+				break;
+
+			} else if (errno == EINTR) {
+				continue;
+
+			// Socket drained.
+			} else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+				break;
+
+			} else {
+				this -> close(connection);
+				return;
+			}
+		}
+
+		state.active = CoreTimers::now();
+		this -> dispatch(connection);
+
+		// Socket may still have data when dispatch made room.
+		if (!full) return;
+
+		found = this -> connections.find(connection);
+		if (found == this -> connections.end() || found -> second.buffer.size() >= limit) return;
+	}
+}
+
+/**
+ * Check wether request headers ask for 100 Continue before the body is sent.
+ * @param head Request line and headers.
+ * @return true when client expects 100 Continue.
+ */
+static bool expectsContinue(std::string_view head) {
+	static const char key[] = "\r\nexpect: 100-continue";
+
+	for (size_t i = 0; i + sizeof(key) - 1 <= head.length(); i++) {
+		if (strncasecmp(head.data() + i, key, sizeof(key) - 1) == 0) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Check wether request headers contain text, case-insensitive. Cheap check
+ * before requests are parsed for upgrades.
+ * @param head Request line and headers.
+ * @param text Text to find.
+ */
+static bool contains(std::string_view head, std::string_view text) {
+	for (size_t i = 0; i + text.length() <= head.length(); i++) {
+		if (strncasecmp(head.data() + i, text.data(), text.length()) == 0) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Route every complete request in order, pipelined requests included.
+ * Small bodies are parsed in place from the receive buffer, large, chunked
+ * and consumed bodies are streamed out of it first. Dispatching pauses
+ * while earlier output waits for the socket.
+ * @param connection Client connection.
+ */
+void CoreReactor::dispatch(const int connection) {
+	Connection &state = this -> connections.at(connection);
+
+	if (state.http2) {
+		this -> multiplex(connection, state);
+		return;
+	}
+
+	if (state.websocket) {
+		this -> converse(connection, state);
+		return;
+	}
+
+	// Deferred output collects responses of pipelined requests until it is submitted.
+	while (!state.busy && !state.stream && (state.output.isDeferred() ? !state.sending : state.output.empty()) && !state.closing) {
+		// Body is streamed out of the buffer until it is complete.
+		if (state.streaming) {
+			if (!this -> stream(connection, state)) break;
+
+			this -> handle(connection, state, state.head, 0);
+			continue;
+		}
+
+		// Client starts with the HTTP/2 preface instead of a request.
+		if (this -> options.http2 && state.requests == 0 && CoreHttp2::isPreface(state.buffer.view())) {
+			if (state.buffer.size() < CoreHttp2::preface.length()) break;
+
+			state.http2 = std::make_unique<CoreHttp2>(this -> options);
+			this -> multiplex(connection, state);
+			return;
+		}
+
+		CoreFrame frame;
+		bool framed = state.buffer.frame(frame);
+
+		// Request line and headers too large.
+		if ((!framed && state.buffer.size() > this -> options.max_header_size) || frame.head > this -> options.max_header_size) {
+			this -> reject(connection, state, 431);
+			break;
+		}
+
+		if (!framed) break;
+
+		// Body length other parsers could read differently.
+		if (frame.invalid) {
+			this -> reject(connection, state, 400);
+			break;
+		}
+
+		// Client out of tokens, answered before the request is parsed. Each request is charged once,
+		// a buffered body arriving in parts frames the same head again.
+		if (this -> rates && !state.rated) {
+			unsigned int retry = this -> rates -> take(state.address, state.buffer.view().substr(0, frame.head));
+
+			if (retry) {
+				this -> reject(connection, state, 429, retry);
+				break;
+			}
+
+			state.rated = true;
+		}
+
+		if (frame.length > this -> options.max_body_size) {
+			this -> reject(connection, state, 413);
+			break;
+		}
+
+		std::string_view head = state.buffer.view().substr(0, frame.head);
+
+		// Request without body upgrades to HTTP/2, it is answered as the first stream.
+		if (this -> options.http2 && frame.length == 0 && !frame.chunked && contains(head, "h2c") && this -> upgrade(connection, state, head)) {
+			return;
+		}
+
+		// Request upgrades to a WebSocket route, invalid handshakes are answered with 400.
+		if (this -> router.hasSockets() && frame.length == 0 && !frame.chunked && contains(head, "websocket")) {
+			if (this -> handshake(connection, state, head)) return;
+			if (state.closing) break;
+		}
+
+		// Client waits for permission to send the body.
+		if (!state.continued && (frame.length > 0 || frame.chunked) && state.buffer.size() == frame.head && expectsContinue(head)) {
+			static const char interim[] = "HTTP/1.1 100 Continue\r\n\r\n";
+
+			if (state.output.isDeferred()) {
+				state.output.append(interim);
+			} else {
+				::send(connection, interim, sizeof(interim) - 1, MSG_NOSIGNAL);
+			}
+
+			state.continued = true;
+		}
+
+		const CoreBody::Consumer *consumer = nullptr;
+		if (this -> router.hasConsumers()) {
+			Request preview(head);
+			consumer = this -> router.consumer(preview.getMethod(), preview.getPath());
+		}
+
+		// Small body, wait until it is buffered and parse request in place.
+		if (!frame.chunked && !consumer && frame.length <= this -> options.body_spill_size) {
+			if (state.buffer.size() < frame.head + frame.length) break;
+
+			this -> handle(connection, state, state.buffer.view().substr(0, frame.head + frame.length), frame.head + frame.length);
+			continue;
+		}
+
+		// Large, chunked or consumed body, headers are kept aside while body is streamed.
+		state.head.assign(head);
+		state.buffer.consume(frame.head);
+
+		if (consumer) {
+			state.preview.emplace(state.head);
+		}
+
+		state.body.reset(this -> options.body_spill_size, this -> options.body_directory, consumer, state.preview ? &*state.preview : nullptr);
+		state.chunked.reset();
+		state.chunked_body = frame.chunked;
+		state.remaining    = frame.length;
+		state.streaming    = true;
+	}
+
+	// Close once everything is written.
+	if (!state.busy && !state.stream && state.output.empty() && (state.closing || state.eof)) {
+		this -> close(connection);
+	} else if (this -> ring && !state.busy) {
+		this -> submit(connection, state);
+	}
+}
+
+/**
+ * Move buffered body bytes of the streamed request into its body.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @return true when body is complete.
+ */
+bool CoreReactor::stream(const int connection, Connection &state) {
+	bool accepted = true;
+
+	if (state.chunked_body) {
+		state.buffer.consume(state.chunked.decode(state.buffer.view(), state.body));
+		accepted = !state.chunked.isFailed();
+
+	} else {
+		size_t take = std::min(state.remaining, state.buffer.size());
+		accepted = take == 0 || state.body.append(state.buffer.view().substr(0, take));
+		state.buffer.consume(take);
+		state.remaining -= take;
+	}
+
+	if (state.body.size() > this -> options.max_body_size) {
+		this -> reject(connection, state, 413);
+		return false;
+	}
+
+	// Malformed chunks or body refused by consumer, temporary file failures are on us.
+	if (!accepted) {
+		this -> reject(connection, state, state.preview || state.chunked_body ? 400 : 500);
+		return false;
+	}
+
+	return state.chunked_body ? state.chunked.isDone() : state.remaining == 0;
+}
+
+/**
+ * Route complete request, on a pool thread when there is one.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param request    Raw request, headers only when body was streamed.
+ * @param length     Buffered bytes used by the request.
+ */
+void CoreReactor::handle(const int connection, Connection &state, std::string_view request, const size_t length) {
+	state.requests++;
+
+	// Last allowed request on this connection and requests while draining are answered with close.
+	bool keep_alive = state.requests < this -> options.keep_alive_requests && !this -> draining;
+	const CoreBody *body = state.streaming ? &state.body : nullptr;
+
+	// Pool thread handles request, buffer and output stay untouched until it finishes.
+	if (this -> pool) {
+		CoreOutput *backlog = &state.output;
+		state.busy   = true;
+		state.length = length;
+
+		bool queued = this -> pool -> submit([this, connection, request, keep_alive, backlog, body] {
+			std::shared_ptr<CoreStream> stream;
+			bool keep = this -> router.respond(connection, request, keep_alive, backlog, body, &stream);
+
+			{
+				std::lock_guard<std::mutex> lock(this -> mutex);
+				this -> completed.push_back({connection, keep, std::move(stream)});
+			}
+
+			uint64_t one = 1;
+			::write(this -> wakeup, &one, sizeof(one));
+		});
+
+		if (queued) return;
+
+		// Pool is full, shed load before running the handler.
+		state.busy = false;
+		state.buffer.consume(length);
+		this -> reject(connection, state, 503, 1);
+		return;
+	}
+
+	std::shared_ptr<CoreStream> stream;
+	keep_alive = this -> router.respond(connection, request, keep_alive, &state.output, body, &stream);
+	state.buffer.consume(length);
+	this -> adopt(connection, state, keep_alive, std::move(stream));
+}
+
+/**
+ * Finish request, or keep connection for the response stream its route left open.
+ * Stream data is written as it is queued, next request waits until the stream ends.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param keep_alive Wether connection stays open after the response.
+ * @param stream     Open response stream or nullptr.
+ */
+void CoreReactor::adopt(const int connection, Connection &state, const bool keep_alive, std::shared_ptr<CoreStream> stream) {
+	if (!stream) {
+		this -> done(state, keep_alive);
+		return;
+	}
+
+	this -> done(state, true);
+	state.stream       = std::move(stream);
+	state.stream_alive = keep_alive;
+	state.stream -> attach(this -> notifier(connection));
+}
+
+/**
+ * Build callback response streams use to wake the reactor once data is queued.
+ * @param connection Client connection.
+ * @return callback, safe to call from any thread.
+ */
+CoreStream::Notify CoreReactor::notifier(const int connection) {
+	return [this, connection] {
+		{
+			std::lock_guard<std::mutex> lock(this -> mutex);
+			this -> signalled.push_back(connection);
+		}
+
+		uint64_t one = 1;
+		::write(this -> wakeup, &one, sizeof(one));
+	};
+}
+
+/**
+ * Move queued stream data to the connection output and write it. Output
+ * that does not fit waits for the socket, stream data waits in the stream.
+ * @param connection Client connection.
+ */
+void CoreReactor::pump(const int connection) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end()) return;
+
+	Connection &state = found -> second;
+
+	if (state.http2) {
+		this -> multiplex(connection, state);
+		return;
+	}
+
+	if (state.websocket) {
+		this -> converse(connection, state);
+		return;
+	}
+
+	if (!state.stream || state.busy || !state.output.empty()) return;
+
+	bool ended = state.stream -> take(state.output);
+
+	if (!state.output.empty() && this -> ring) {
+		this -> submit(connection, state);
+		return;
+	}
+
+	if (!state.output.empty()) {
+		if (!state.output.flush(connection)) {
+			this -> close(connection);
+			return;
+		}
+
+		state.active = CoreTimers::now();
+	}
+
+	// Flush continues once output is written.
+	if (!ended || !state.output.empty()) return;
+
+	// Stream ended, continue with the next request.
+	if (!state.stream_alive) state.closing = true;
+	state.stream.reset();
+	this -> receive(connection);
+}
+
+/**
+ * Reset request state once it was answered.
+ * @param state      Connection state.
+ * @param keep_alive Wether connection stays open.
+ */
+void CoreReactor::done(Connection &state, const bool keep_alive) {
+	if (state.streaming) {
+		state.body.reset(0, "");
+		state.preview.reset();
+		state.streaming = false;
+	}
+
+	// Pipelined request waiting in the buffer starts now.
+	state.continued = false;
+	state.rated     = false;
+	state.started   = CoreTimers::now();
+	if (!keep_alive || this -> draining) state.closing = true;
+}
+
+/**
+ * Answer with error status without routing, connection closes after it.
+ * @param connection  Client connection.
+ * @param state       Connection state.
+ * @param status      HTTP status code.
+ * @param retry_after Seconds the client should wait before retrying, 0 to omit.
+ */
+void CoreReactor::reject(const int connection, Connection &state, const unsigned int status, const unsigned int retry_after) {
+	this -> router.reject(connection, status, retry_after, &state.output);
+	this -> done(state, false);
+}
+
+/**
+ * Write output that did not fit into the socket earlier.
+ * @param connection Client connection.
+ */
+void CoreReactor::flush(const int connection) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end() || found -> second.output.empty() || found -> second.busy) return;
+
+	Connection &state = found -> second;
+
+	if (this -> ring) {
+		this -> submit(connection, state);
+		return;
+	}
+
+	if (!state.output.flush(connection)) {
+		this -> close(connection);
+		return;
+	}
+
+	state.active = CoreTimers::now();
+
+	// Output drained, continue with stream or pipelined and unread requests.
+	if (state.output.empty() && state.stream) {
+		this -> pump(connection);
+	} else if (state.output.empty()) {
+		this -> receive(connection);
+	}
+}
+
+/**
+ * Continue connections whose handlers finished on pool threads.
+ */
+void CoreReactor::complete() {
+	uint64_t count;
+	while (::read(this -> wakeup, &count, sizeof(count)) > 0);
+
+	std::vector<Completion> completed;
+	std::vector<int> signalled;
+	{
+		std::lock_guard<std::mutex> lock(this -> mutex);
+		completed.swap(this -> completed);
+		signalled.swap(this -> signalled);
+	}
+
+	for (Completion &completion : completed) {
+		if (completion.id) {
+			this -> answered(completion.connection, completion.id, std::move(completion.stream));
+		} else {
+			this -> finish(completion.connection, completion.keep_alive, std::move(completion.stream));
+		}
+
+		this -> touch(completion.connection);
+	}
+
+	// Streams with queued data.
+	for (const int connection : signalled) {
+		this -> pump(connection);
+		this -> touch(connection);
+	}
+}
+
+/**
+ * Release connection after its handler finished, then read input and
+ * write output that arrived or queued meanwhile.
+ * @param connection Client connection.
+ * @param keep_alive Wether connection stays open.
+ * @param stream     Response stream left open by the handler.
+ */
+void CoreReactor::finish(const int connection, const bool keep_alive, std::shared_ptr<CoreStream> stream) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end()) return;
+
+	Connection &state = found -> second;
+	state.busy = false;
+	state.buffer.consume(state.length);
+	state.active = CoreTimers::now();
+	this -> adopt(connection, state, keep_alive, std::move(stream));
+
+	// Socket events were skipped while busy.
+	if (!state.output.empty()) {
+		this -> flush(connection);
+	}
+
+	this -> receive(connection);
+}
+
+/**
+ * Close connection and forget its buffered input. Busy connections close
+ * once their handler finishes, HTTP/2 connections once their streams' routes
+ * returned, on io_uring connections with a send in
+ * flight once it completes.
+ * @param connection Client connection.
+ */
+void CoreReactor::close(const int connection) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end() || found -> second.released) return;
+
+	Connection &state = found -> second;
+
+	// Routes of HTTP/2 streams write to outputs of the session.
+	if (state.busy || (state.http2 && state.http2 -> isRunning())) {
+		state.closing = true;
+		return;
+	}
+
+	if (this -> ring) {
+		if (state.receiving) this -> ring -> cancel(tag(Receive, connection, state.generation), tag(Cancel));
+		if (state.polling)   this -> ring -> cancel(tag(Writable, connection, state.generation), tag(Cancel));
+
+		// Output is in use until the send completes.
+		if (state.sending) {
+			state.released = true;
+			this -> ring -> cancel(tag(Send, connection, state.generation), tag(Cancel));
+			return;
+		}
+
+		this -> ring -> close(connection, tag(Close));
+	} else {
+		::close(connection);
+	}
+
+	this -> forget(found);
+}
+
+/**
+ * Forget closed connection.
+ * @param found Connection.
+ */
+void CoreReactor::forget(std::unordered_map<int, Connection>::iterator found) {
+	// Producers of the stream find the client gone.
+	if (found -> second.stream) {
+		found -> second.stream -> close();
+	}
+
+	if (found -> second.websocket) {
+		found -> second.websocket -> drop();
+	}
+
+	if (found -> second.limited) {
+		this -> limits -> release(found -> second.address);
+	}
+
+	this -> connections.erase(found);
+
+	if (CoreMetrics *metrics = this -> router.getMetrics()) {
+		metrics -> close();
+	}
+}
+
+/**
+ * Switch connection to HTTP/2 after a request asking for h2c, the request
+ * becomes the first stream and is answered over HTTP/2.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param head       Request line and headers, the request has no body.
+ * @return false when request does not upgrade and is routed as usual.
+ */
+bool CoreReactor::upgrade(const int connection, Connection &state, std::string_view head) {
+	Request preview(head);
+	std::string_view settings = preview.getHeader("HTTP2-Settings");
+
+	std::string_view protocol = preview.getHeader("Upgrade");
+
+	if (protocol.length() != 3 || strncasecmp(protocol.data(), "h2c", 3) != 0 || settings.empty()) return false;
+
+	auto session = std::make_unique<CoreHttp2>(this -> options);
+	CoreHttp2::Stream *stream = session -> upgrade(head, settings);
+	if (!stream) return false;
+
+	static const char switching[] = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+	state.output.append(switching);
+
+	// Upgrade request was charged as HTTP/1.1 request already, serve counts it.
+	state.http2 = std::move(session);
+	state.buffer.consume(head.length());
+	stream -> rated = true;
+
+	this -> serve(connection, state, *stream);
+	this -> multiplex(connection, state);
+	return true;
+}
+
+/**
+ * Handle received frames of an HTTP/2 connection, route streams whose request
+ * is complete and write frames of answered streams. Writing continues while
+ * the socket takes all of the output and responses have data within windows,
+ * data is framed once earlier output was written.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ */
+void CoreReactor::multiplex(const int connection, Connection &state) {
+	std::vector<uint32_t> ready;
+	state.buffer.consume(state.http2 -> receive(state.buffer.view(), ready));
+
+	for (const uint32_t id : ready) {
+		if (CoreHttp2::Stream *stream = state.http2 -> find(id)) {
+			this -> serve(connection, state, *stream);
+		}
+	}
+
+	if (this -> draining) {
+		state.http2 -> shutdown();
+	}
+
+	// Output in flight is extended once the send completed.
+	if (this -> ring && state.sending) return;
+
+	while (true) {
+		bool room = this -> ring || state.output.empty();
+		bool more = state.http2 -> write(state.output, room);
+		if (state.http2 -> isClosed()) state.closing = true;
+
+		if (!state.http2 -> isRunning() && state.output.empty() && (state.closing || state.eof)) {
+			this -> close(connection);
+			return;
+		}
+
+		if (this -> ring) {
+			this -> submit(connection, state);
+			return;
+		}
+
+		if (!state.output.flush(connection)) {
+			this -> close(connection);
+			return;
+		}
+
+		state.active = CoreTimers::now();
+
+		// Socket is full, or everything within windows was written.
+		if (!state.output.empty() || (room && !more)) break;
+	}
+
+	if (!state.http2 -> isRunning() && state.output.empty() && (state.closing || state.eof)) {
+		this -> close(connection);
+	}
+}
+
+/**
+ * Route request of an HTTP/2 stream, on a pool thread when there is one.
+ * Routes write the response to the stream output, it is framed once they return.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param stream     Stream with complete request, or with a status to answer with.
+ */
+void CoreReactor::serve(const int connection, Connection &state, CoreHttp2::Stream &stream) {
+	if (stream.status) {
+		this -> router.reject(connection, stream.status, 0, &stream.output);
+		state.http2 -> answer(stream, nullptr);
+		return;
+	}
+
+	// Client out of tokens, the stream is refused and the connection stays open.
+	if (unsigned int retry = this -> rates && !stream.rated ? this -> rates -> take(state.address, stream.request) : 0) {
+		this -> router.reject(connection, 429, retry, &stream.output);
+		state.http2 -> answer(stream, nullptr);
+		return;
+	}
+
+	state.requests++;
+
+	if (this -> pool) {
+		state.http2 -> run(stream);
+
+		const uint32_t id = stream.id;
+		std::string_view request = stream.request;
+		CoreOutput *output = &stream.output;
+
+		bool queued = this -> pool -> submit([this, connection, id, request, output] {
+			std::shared_ptr<CoreStream> response;
+			this -> router.respond(connection, request, true, output, nullptr, &response);
+
+			{
+				std::lock_guard<std::mutex> lock(this -> mutex);
+				this -> completed.push_back({connection, true, std::move(response), id});
+			}
+
+			uint64_t one = 1;
+			::write(this -> wakeup, &one, sizeof(one));
+		});
+
+		if (queued) return;
+
+		// Pool is full, shed load before running the route.
+		this -> router.reject(connection, 503, 1, &stream.output);
+		state.http2 -> answer(stream, nullptr);
+		return;
+	}
+
+	std::shared_ptr<CoreStream> response;
+	this -> router.respond(connection, stream.request, true, &stream.output, nullptr, &response);
+	if (response) response -> attach(this -> notifier(connection));
+	state.http2 -> answer(stream, std::move(response));
+}
+
+/**
+ * Continue HTTP/2 stream whose route finished on a pool thread.
+ * @param connection Client connection.
+ * @param id         Stream id.
+ * @param stream     Response stream left open by the route.
+ */
+void CoreReactor::answered(const int connection, const uint32_t id, std::shared_ptr<CoreStream> stream) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end() || !found -> second.http2) return;
+
+	Connection &state = found -> second;
+	CoreHttp2::Stream *pending = state.http2 -> find(id);
+	if (!pending) return;
+
+	if (stream) stream -> attach(this -> notifier(connection));
+	state.http2 -> answer(*pending, std::move(stream));
+	state.active = CoreTimers::now();
+
+	if (!state.released) {
+		this -> multiplex(connection, state);
+	}
+}
+
+/**
+ * Answer WebSocket opening handshake and hand the connection to the socket.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param head       Request line and headers, the request has no body.
+ * @return true when connection became a WebSocket, false when request is
+ *         routed as usual or was answered with 400.
+ */
+bool CoreReactor::handshake(const int connection, Connection &state, std::string_view head) {
+	Request request(head);
+	std::string_view protocol = request.getHeader("Upgrade");
+
+	if (protocol.length() != 9 || strncasecmp(protocol.data(), "websocket", 9) != 0) return false;
+
+	const CoreWebSocket::Handlers *handlers = this -> router.socket(request);
+	if (!handlers) return false;
+
+	std::string answer;
+
+	if (!CoreWebSocket::handshake(request, answer)) {
+		state.buffer.consume(head.length());
+		this -> reject(connection, state, 400);
+		return false;
+	}
+
+	state.requests++;
+	state.output.append(answer);
+	state.websocket = std::make_shared<CoreWebSocket>(*handlers, this -> options.max_body_size);
+	state.websocket -> attach(this -> notifier(connection));
+	state.websocket -> open(request);
+	state.buffer.consume(head.length());
+
+	this -> converse(connection, state);
+	return true;
+}
+
+/**
+ * Handle received frames of a WebSocket and write the frames queued for it.
+ * Connection closes once the closing handshake finished and output is written.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ */
+void CoreReactor::converse(const int connection, Connection &state) {
+	state.buffer.consume(state.websocket -> receive(state.buffer.view()));
+
+	// Output in flight is extended once the send completed.
+	if (this -> ring && state.sending) return;
+
+	if (state.websocket -> take(state.output)) state.closing = true;
+
+	if (state.output.empty() && (state.closing || state.eof)) {
+		this -> close(connection);
+		return;
+	}
+
+	if (this -> ring) {
+		this -> submit(connection, state);
+		return;
+	}
+
+	if (state.output.empty()) return;
+
+	if (!state.output.flush(connection)) {
+		this -> close(connection);
+		return;
+	}
+
+	state.active = CoreTimers::now();
+
+	if (state.output.empty() && (state.closing || state.eof)) {
+		this -> close(connection);
+	}
+}
+
+/**
+ * Build io_uring completion tag.
+ * @param operation  Operation.
+ * @param connection Connection of the operation.
+ * @param generation Generation of the connection.
+ * @return tag.
+ */
+uint64_t CoreReactor::tag(const Operation operation, const int connection, const uint32_t generation) {
+	return operation << 56 | uint64_t(generation & 0xffffff) << 32 | uint32_t(connection);
+}
+
+/**
+ * Run io_uring event loop until it is drained after stop or fails. Operations
+ * prepared while handling completions are submitted with the next wait.
+ */
+int CoreReactor::cycle() {
+	while (true) {
+		if (this -> ring -> wait(this -> draining || this -> backoff ? retry_ms : timer_ms) == -1) {
+			perror("Event loop failed: ");
+			return EXIT_FAILURE;
+		}
+
+		this -> ring -> complete([this](const io_uring_cqe &completion) {
+			this -> event(completion);
+		});
+
+		// Accept connections that waited while descriptors ran out.
+		if (!this -> accepting && !this -> draining && std::chrono::steady_clock::now() >= this -> retry) {
+			this -> ring -> accept(this -> server, tag(Accept));
+			this -> accepting = true;
+		}
+
+		this -> expire();
+
+		if (this -> draining && this -> drained()) {
+			return EXIT_SUCCESS;
+		}
+	}
+}
+
+/**
+ * Handle io_uring completion.
+ * @param completion Completion.
+ */
+void CoreReactor::event(const io_uring_cqe &completion) {
+	Operation operation = static_cast<Operation>(completion.user_data >> 56);
+	uint32_t generation = (completion.user_data >> 32) & 0xffffff;
+	int connection      = static_cast<uint32_t>(completion.user_data);
+	bool more           = completion.flags & IORING_CQE_F_MORE;
+
+	if (operation == Accept) {
+		this -> accepted(completion);
+		return;
+	}
+
+	// Handlers finished on pool threads, poll stays armed while more completions follow.
+	if (operation == Wakeup) {
+		this -> complete();
+		if (!more) this -> ring -> poll(this -> wakeup, POLLIN, true, tag(Wakeup));
+		return;
+	}
+
+	// Server stopped.
+	if (operation == Stop) {
+		if (completion.res != -ECANCELED) this -> drain();
+		return;
+	}
+
+	if (operation == Cancel) return;
+
+	// Provided buffers, completions of closed connections and earlier connections on the same descriptor.
+	auto found = this -> connections.find(connection);
+	if (generation == 0 || found == this -> connections.end() || found -> second.generation != generation) {
+		if (operation == Receive) this -> ring -> recycle(completion);
+		return;
+	}
+
+	Connection &state = found -> second;
+
+	if (operation == Receive) {
+		this -> received(connection, state, completion);
+
+	} else if (operation == Send) {
+		this -> sent(connection, state, completion);
+
+	// Socket writable again for the file range that did not fit.
+	} else if (operation == Writable) {
+		state.polling = false;
+		if (!state.released && !state.busy) this -> submit(connection, state);
+
+	// Linked close ran, or was cancelled since the send before it failed.
+	} else if (operation == Close) {
+		if (completion.res < 0) ::close(connection);
+		this -> forget(found);
+		return;
+	}
+
+	this -> touch(connection);
+}
+
+/**
+ * Register connection accepted by the multishot accept, or back off when out of descriptors or memory.
+ * @param completion Accept completion.
+ */
+void CoreReactor::accepted(const io_uring_cqe &completion) {
+	if (!(completion.flags & IORING_CQE_F_MORE)) {
+		this -> accepting = false;
+	}
+
+	if (completion.res >= 0) {
+		this -> backoff = 0;
+		this -> open(completion.res, nullptr);
+		return;
+	}
+
+	int error = -completion.res;
+
+	// Connections wait in the accept queue until retry.
+	if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM) {
+		if (!this -> backoff) {
+			errno = error;
+			perror("Accepting paused: ");
+		}
+
+		this -> backoff = std::min(this -> backoff ? this -> backoff * 2 : retry_ms / 10, backoff_ms);
+		this -> retry   = std::chrono::steady_clock::now() + std::chrono::milliseconds(this -> backoff);
+
+		if (this -> accepting) {
+			this -> ring -> cancel(tag(Accept), tag(Cancel));
+		}
+
+		return;
+	}
+
+	if (error != ECANCELED && error != EINTR && error != ECONNABORTED) {
+		errno = error;
+		perror("Request failed: ");
+	}
+}
+
+/**
+ * Take data of a multishot receive, input arriving while the handler parses the buffer is stashed.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param completion Receive completion.
+ */
+void CoreReactor::received(const int connection, Connection &state, const io_uring_cqe &completion) {
+	if (completion.res > 0) {
+		std::string_view data = this -> ring -> buffer(completion);
+
+		if (state.buffer.empty() && state.stash.empty()) {
+			state.started = CoreTimers::now();
+		}
+
+		if (state.busy) {
+			state.stash.append(data);
+		} else {
+			state.buffer.append(data);
+		}
+
+		this -> ring -> recycle(completion);
+		state.active = CoreTimers::now();
+	}
+
+	if (!(completion.flags & IORING_CQE_F_MORE)) {
+		state.receiving = false;
+	}
+
+	// Client closed its side, answer what is already buffered.
+	if (completion.res == 0) {
+		state.eof = true;
+
+	// Out of provided buffers or paused, receiving is armed again while there is room.
+	} else if (completion.res < 0 && completion.res != -ENOBUFS && completion.res != -ECANCELED) {
+		this -> close(connection);
+		return;
+	}
+
+	if (!state.released) {
+		this -> resume(connection);
+	}
+}
+
+/**
+ * Dispatch buffered requests and keep receiving while the buffer has room.
+ * @param connection Client connection.
+ */
+void CoreReactor::resume(const int connection) {
+	auto found = this -> connections.find(connection);
+	if (found == this -> connections.end() || found -> second.busy || found -> second.released) return;
+
+	Connection &state = found -> second;
+
+	if (!state.stash.empty()) {
+		state.buffer.append(state.stash);
+		state.stash.clear();
+	}
+
+	this -> dispatch(connection);
+
+	found = this -> connections.find(connection);
+	if (found == this -> connections.end() || found -> second.released) return;
+
+	size_t limit = this -> options.max_header_size + this -> options.body_spill_size;
+	bool full    = state.buffer.size() >= limit;
+
+	if (!state.receiving && !full && !state.eof && !state.closing) {
+		state.receiving = true;
+		state.paused    = false;
+		this -> ring -> receive(connection, tag(Receive, connection, state.generation));
+
+	// Pause until requests made room.
+	} else if (state.receiving && full && !state.paused) {
+		state.paused = true;
+		this -> ring -> cancel(tag(Receive, connection, state.generation), tag(Cancel));
+	}
+}
+
+/**
+ * Submit queued output. When connection closes after it, the close is linked
+ * to the send so both go to the kernel at once. File ranges are written with
+ * sendfile and wait for writability when the socket is full.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ */
+void CoreReactor::submit(const int connection, Connection &state) {
+	if (state.sending || state.polling || state.released || state.output.empty()) return;
+
+	bool complete = false;
+	size_t count  = state.output.gather(state.parts.data(), state.parts.size(), complete);
+
+	if (count == 0) {
+		if (!state.output.flush(connection)) {
+			this -> close(connection);
+			return;
+		}
+
+		state.active = CoreTimers::now();
+
+		if (!state.output.empty()) {
+			state.polling = true;
+			this -> ring -> poll(connection, POLLOUT, false, tag(Writable, connection, state.generation));
+			return;
+		}
+
+		this -> written(connection, state);
+		return;
+	}
+
+	state.message = {};
+	state.message.msg_iov    = state.parts.data();
+	state.message.msg_iovlen = count;
+	state.sending = true;
+
+	// Last response, nothing is received any more.
+	bool last = complete && !state.stream && (!state.http2 || state.http2 -> isIdle()) && (state.closing || state.eof);
+
+	if (last) {
+		if (state.receiving) this -> ring -> cancel(tag(Receive, connection, state.generation), tag(Cancel));
+
+		state.linked   = true;
+		state.released = true;
+	}
+
+	this -> ring -> send(connection, &state.message, tag(Send, connection, state.generation), last);
+	if (last) this -> ring -> close(connection, tag(Close, connection, state.generation));
+}
+
+/**
+ * Continue after output was sent.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ * @param completion Send completion.
+ */
+void CoreReactor::sent(const int connection, Connection &state, const io_uring_cqe &completion) {
+	state.sending = false;
+
+	// Linked close completes next and forgets the connection.
+	if (state.linked) return;
+
+	// Closed while sending.
+	if (state.released) {
+		this -> ring -> close(connection, tag(Close));
+		this -> forget(this -> connections.find(connection));
+		return;
+	}
+
+	if (completion.res == -EAGAIN) {
+		state.polling = true;
+		this -> ring -> poll(connection, POLLOUT, false, tag(Writable, connection, state.generation));
+		return;
+	}
+
+	if (completion.res < 0) {
+		this -> close(connection);
+		return;
+	}
+
+	state.output.advance(completion.res);
+	state.active = CoreTimers::now();
+
+	if (!state.output.empty()) {
+		this -> submit(connection, state);
+		return;
+	}
+
+	this -> written(connection, state);
+}
+
+/**
+ * Continue with stream or pipelined and unread requests once output is written.
+ * @param connection Client connection.
+ * @param state      Connection state.
+ */
+void CoreReactor::written(const int connection, Connection &state) {
+	if (state.stream) {
+		this -> pump(connection);
+	} else {
+		this -> resume(connection);
+	}
+}
@@ -0,0 +1,202 @@
+#ifndef CORE_REACTOR_HPP
+#define CORE_REACTOR_HPP
+
+#include <core/router/router.hpp>
+#include <core/buffer/buffer.hpp>
+#include <core/output/output.hpp>
+#include <core/body/body.hpp>
+#include <core/stream/stream.hpp>
+#include <core/server/options.hpp>
+#include <core/pool/pool.hpp>
+#include <core/timers/timers.hpp>
+#include <core/limits/limits.hpp>
+#include <core/limits/rate.hpp>
+#include <core/ring/ring.hpp>
+#include <core/http2/http2.hpp>
+#include <core/websocket/websocket.hpp>
+
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Event loop serving every connection of one listener. Edge-triggered epoll
+ * by default, or io_uring with multishot accept and receive, batched sends
+ * and sends linked to the close of the connection.
+ */
+class CoreReactor {
+	public:
+		CoreReactor(CoreRouter &router, const int &server, const CoreOptions &options, CorePool *pool = nullptr, const int stop = -1, CoreLimits *limits = nullptr, CoreRateLimit *rates = nullptr);
+		~CoreReactor();
+
+		int run();
+
+	private:
+		static constexpr int events_max = 256;
+		static constexpr int timer_ms   = 100;
+		static constexpr int retry_ms   = 100;
+		static constexpr int backoff_ms = 1000;
+
+		// State of one open connection.
+		struct Connection {
+			CoreBuffer buffer;
+			CoreOutput output;
+			unsigned int requests = 0;
+			size_t length  = 0;
+			bool closing   = false;
+			bool eof       = false;
+			bool busy      = false;
+			bool continued = false;
+			bool rated     = false;
+
+			// Streamed body of the current request, headers are kept aside.
+			bool streaming    = false;
+			bool chunked_body = false;
+			size_t remaining  = 0;
+			std::string head;
+			std::optional<Request> preview;
+			CoreBody body;
+			CoreChunked chunked;
+
+			// Response stream left open by the handler, keeps connection until it ends.
+			std::shared_ptr<CoreStream> stream;
+			bool stream_alive = false;
+
+			// Last progress and arrival of the current request, in timer ticks.
+			uint64_t active  = CoreTimers::now();
+			uint64_t started = active;
+
+			// Deadline tick of the pending timer, 0 when none is.
+			uint64_t scheduled = 0;
+
+			// Client address counted by limits and rate limited.
+			CoreLimits::Address address;
+			bool limited = false;
+
+			// io_uring operations in flight, generation tells completions of reused descriptors apart.
+			uint32_t generation = 0;
+			bool receiving = false;
+			bool paused    = false;
+			bool sending   = false;
+			bool polling   = false;
+			bool linked    = false;
+			bool released  = false;
+
+			// Input received while the handler parses the buffer, output message in flight.
+			std::string stash;
+			msghdr message = {};
+			std::array<iovec, 8> parts;
+
+			// HTTP/2 session once the client sent the preface or upgraded.
+			std::unique_ptr<CoreHttp2> http2;
+
+			// WebSocket once the client upgraded.
+			std::shared_ptr<CoreWebSocket> websocket;
+		};
+
+		// Operations of io_uring completion tags.
+		enum Operation : uint64_t {
+			Accept = 1,
+			Wakeup,
+			Stop,
+			Receive,
+			Send,
+			Writable,
+			Close,
+			Cancel
+		};
+
+		CoreRouter &router;
+		const int server;
+		const CoreOptions &options;
+		CorePool *pool;
+		const int stop;
+		CoreLimits *limits;
+		CoreRateLimit *rates;
+		int poll = -1;
+
+		// io_uring backend, epoll is used without it.
+		std::unique_ptr<CoreRing> ring;
+		uint32_t generations = 0;
+		bool accepting = false;
+
+		// Connection timeouts.
+		CoreTimers timers;
+		std::vector<CoreTimers::Timer> expired;
+
+		// Stopped, in-flight requests finish until deadline.
+		bool draining = false;
+		std::chrono::steady_clock::time_point deadline;
+
+		// Accepting paused while out of descriptors or memory.
+		int backoff = 0;
+		std::chrono::steady_clock::time_point retry;
+
+		// Request finished by a pool thread, HTTP/2 requests have their stream id.
+		struct Completion {
+			int connection;
+			bool keep_alive;
+			std::shared_ptr<CoreStream> stream;
+			uint32_t id = 0;
+		};
+
+		// Requests finished by pool threads and streams with queued data, announced through wakeup.
+		int wakeup;
+		std::mutex mutex;
+		std::vector<Completion> completed;
+		std::vector<int> signalled;
+
+		std::unordered_map<int, Connection> connections;
+
+		void accept();
+		void open(const int connection, const sockaddr_storage *peer);
+		void forget(std::unordered_map<int, Connection>::iterator found);
+		void drain();
+		bool drained();
+		void receive(const int connection);
+		void dispatch(const int connection);
+		bool stream(const int connection, Connection &state);
+		void handle(const int connection, Connection &state, std::string_view request, const size_t length);
+		void done(Connection &state, const bool keep_alive);
+		void adopt(const int connection, Connection &state, const bool keep_alive, std::shared_ptr<CoreStream> stream);
+		void pump(const int connection);
+		void reject(const int connection, Connection &state, const unsigned int status, const unsigned int retry_after = 0);
+		void flush(const int connection);
+		void complete();
+		void finish(const int connection, const bool keep_alive, std::shared_ptr<CoreStream> stream);
+		void close(const int connection);
+		CoreStream::Notify notifier(const int connection);
+		void touch(const int connection);
+		uint64_t expiry(const Connection &state) const;
+		void expire();
+
+		// HTTP/2 connections.
+		bool upgrade(const int connection, Connection &state, std::string_view head);
+		void multiplex(const int connection, Connection &state);
+		void serve(const int connection, Connection &state, CoreHttp2::Stream &stream);
+		void answered(const int connection, const uint32_t id, std::shared_ptr<CoreStream> stream);
+
+		// WebSocket connections.
+		bool handshake(const int connection, Connection &state, std::string_view head);
+		void converse(const int connection, Connection &state);
+
+		// io_uring backend.
+		int cycle();
+		void event(const io_uring_cqe &completion);
+		void accepted(const io_uring_cqe &completion);
+		void received(const int connection, Connection &state, const io_uring_cqe &completion);
+		void sent(const int connection, Connection &state, const io_uring_cqe &completion);
+		void resume(const int connection);
+		void submit(const int connection, Connection &state);
+		void written(const int connection, Connection &state);
+		static uint64_t tag(const Operation operation, const int connection = 0, const uint32_t generation = 0);
+};
+
+#endif
@@ -0,0 +1,318 @@
+#include <core/ring/ring.hpp>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+/**
+ * Set up ring, check isReady() since kernels without io_uring or with it disabled fail here.
+ * @param entries     Submission queue size, completion queue is four times larger.
+ * @param buffers     Provided receive buffers.
+ * @param buffer_size Size of one receive buffer.
+ */
+CoreRing::CoreRing(const unsigned int entries, const unsigned int buffers, const unsigned int buffer_size) {
+	io_uring_params params = {};
+	params.flags      = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN;
+	params.cq_entries = entries * 4;
+
+	this -> ring = syscall(__NR_io_uring_setup, entries, &params);
+
+	// Older kernels lack task run flags, completions are then run on any kernel entry.
+	if (this -> ring == -1 && errno == EINVAL) {
+		params = {};
+		params.flags      = IORING_SETUP_CQSIZE;
+		params.cq_entries = entries * 4;
+		this -> ring = syscall(__NR_io_uring_setup, entries, &params);
+	}
+
+	if (this -> ring == -1 || !(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+		if (this -> ring != -1) ::close(this -> ring);
+		this -> ring = -1;
+		return;
+	}
+
+	this -> entries = params.sq_entries;
+
+	// Both queues share one mapping.
+	this -> sq_map_size = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned int), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+	this -> sq_map = mmap(nullptr, this -> sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this -> ring, IORING_OFF_SQ_RING);
+
+	this -> sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+	this -> sqes = static_cast<io_uring_sqe*>(mmap(nullptr, this -> sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, this -> ring, IORING_OFF_SQES));
+
+	if (this -> sq_map == MAP_FAILED || this -> sqes == MAP_FAILED) {
+		if (this -> sq_map != MAP_FAILED) munmap(this -> sq_map, this -> sq_map_size);
+		if (this -> sqes != MAP_FAILED) munmap(this -> sqes, this -> sqes_size);
+		this -> sq_map = nullptr;
+		this -> sqes   = nullptr;
+		::close(this -> ring);
+		this -> ring = -1;
+		return;
+	}
+
+	char *map = static_cast<char*>(this -> sq_map);
+	this -> sq_head  = reinterpret_cast<unsigned int*>(map + params.sq_off.head);
+	this -> sq_tail  = reinterpret_cast<unsigned int*>(map + params.sq_off.tail);
+	this -> sq_mask  = reinterpret_cast<unsigned int*>(map + params.sq_off.ring_mask);
+	this -> sq_array = reinterpret_cast<unsigned int*>(map + params.sq_off.array);
+	this -> tail     = *this -> sq_tail;
+
+	this -> cq_head = reinterpret_cast<unsigned int*>(map + params.cq_off.head);
+	this -> cq_tail = reinterpret_cast<unsigned int*>(map + params.cq_off.tail);
+	this -> cq_mask = reinterpret_cast<unsigned int*>(map + params.cq_off.ring_mask);
+	this -> cqes    = reinterpret_cast<io_uring_cqe*>(map + params.cq_off.cqes);
+
+	if (!this -> provide(buffers, buffer_size)) {
+		this -> release();
+	}
+}
+
+/**
+ * Release ring.
+ */
+CoreRing::~CoreRing() {
+	this -> release();
+}
+
+/**
+ * Unmap queues and buffers and close ring, pending operations are cancelled by the kernel.
+ */
+void CoreRing::release() {
+	if (this -> ring == -1) return;
+
+	if (this -> buffer_data) munmap(this -> buffer_data, size_t(this -> buffer_count) * this -> buffer_size);
+	munmap(this -> sqes, this -> sqes_size);
+	munmap(this -> sq_map, this -> sq_map_size);
+	::close(this -> ring);
+
+	this -> ring = -1;
+	this -> buffer_data = nullptr;
+}
+
+/**
+ * Check wether ring was set up.
+ */
+bool CoreRing::isReady() const {
+	return this -> ring != -1;
+}
+
+/**
+ * Check wether kernel has everything the ring backend uses: multishot recv needs 6.0.
+ * @return true when io_uring can be used.
+ */
+bool CoreRing::supported() {
+	utsname name;
+	unsigned int major = 0, minor = 0;
+
+	if (uname(&name) != 0 || sscanf(name.release, "%u.%u", &major, &minor) != 2 || major < 6) {
+		return false;
+	}
+
+	CoreRing ring(8, 1, 4096);
+	return ring.isReady();
+}
+
+/**
+ * Map buffers and provide them to the kernel, the operation runs ahead of
+ * receives submitted after it.
+ * @param count Number of buffers.
+ * @param size  Size of one buffer.
+ * @return false when buffers could not be mapped.
+ */
+bool CoreRing::provide(const unsigned int count, const unsigned int size) {
+	void *data = mmap(nullptr, size_t(count) * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (data == MAP_FAILED) return false;
+
+	this -> buffer_data  = static_cast<char*>(data);
+	this -> buffer_count = count;
+	this -> buffer_size  = size;
+
+	this -> add(0, count);
+	return true;
+}
+
+/**
+ * Hand buffers to the kernel.
+ * @param id    First buffer id.
+ * @param count Number of consecutive buffers.
+ */
+void CoreRing::add(const unsigned int id, const unsigned int count) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode    = IORING_OP_PROVIDE_BUFFERS;
+	entry -> fd        = count;
+	entry -> addr      = reinterpret_cast<uint64_t>(this -> buffer_data + size_t(id) * this -> buffer_size);
+	entry -> len       = this -> buffer_size;
+	entry -> off       = id;
+	entry -> buf_group = buffer_group;
+	entry -> user_data = 0;
+}
+
+/**
+ * Get data received into a provided buffer.
+ * @param completion Receive completion with a buffer.
+ * @return received bytes.
+ */
+std::string_view CoreRing::buffer(const io_uring_cqe &completion) const {
+	unsigned int id = completion.flags >> IORING_CQE_BUFFER_SHIFT;
+	return std::string_view(this -> buffer_data + size_t(id) * this -> buffer_size, completion.res);
+}
+
+/**
+ * Hand provided buffer back to the kernel.
+ * @param completion Receive completion with a buffer.
+ */
+void CoreRing::recycle(const io_uring_cqe &completion) {
+	if (!(completion.flags & IORING_CQE_F_BUFFER)) return;
+
+	this -> add(completion.flags >> IORING_CQE_BUFFER_SHIFT, 1);
+}
+
+/**
+ * Get free submission entry, full queue is submitted first.
+ * @return cleared entry.
+ */
+io_uring_sqe *CoreRing::next() {
+	if (this -> tail - __atomic_load_n(this -> sq_head, __ATOMIC_ACQUIRE) >= this -> entries) {
+		this -> enter(this -> queued, 0, 0, nullptr, 0);
+	}
+
+	unsigned int index = this -> tail & *this -> sq_mask;
+	io_uring_sqe *entry = &this -> sqes[index];
+	memset(entry, 0, sizeof(*entry));
+
+	this -> sq_array[index] = index;
+	this -> tail++;
+	this -> queued++;
+	__atomic_store_n(this -> sq_tail, this -> tail, __ATOMIC_RELEASE);
+
+	return entry;
+}
+
+/**
+ * Accept connections until cancelled or failed, each one completes with its descriptor.
+ * @param server Listening socket.
+ * @param tag    Completion tag.
+ */
+void CoreRing::accept(const int server, const uint64_t tag) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode       = IORING_OP_ACCEPT;
+	entry -> fd           = server;
+	entry -> ioprio       = IORING_ACCEPT_MULTISHOT;
+	entry -> accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	entry -> user_data    = tag;
+}
+
+/**
+ * Receive into provided buffers until cancelled, closed or buffers run out.
+ * @param connection Client connection.
+ * @param tag        Completion tag.
+ */
+void CoreRing::receive(const int connection, const uint64_t tag) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode    = IORING_OP_RECV;
+	entry -> fd        = connection;
+	entry -> ioprio    = IORING_RECV_MULTISHOT;
+	entry -> flags     = IOSQE_BUFFER_SELECT;
+	entry -> buf_group = buffer_group;
+	entry -> user_data = tag;
+}
+
+/**
+ * Send message, linked sends are sent whole or fail so the linked operation is cancelled.
+ * @param connection Client connection.
+ * @param message    Message, has to stay valid until completion.
+ * @param tag        Completion tag.
+ * @param link       Wether the next submission runs only after this one succeeded.
+ */
+void CoreRing::send(const int connection, const msghdr *message, const uint64_t tag, const bool link) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode    = IORING_OP_SENDMSG;
+	entry -> fd        = connection;
+	entry -> addr      = reinterpret_cast<uint64_t>(message);
+	entry -> msg_flags = MSG_NOSIGNAL | (link ? MSG_WAITALL : 0);
+	entry -> flags     = link ? IOSQE_IO_LINK : 0;
+	entry -> user_data = tag;
+}
+
+/**
+ * Close descriptor.
+ * @param connection Descriptor.
+ * @param tag        Completion tag.
+ */
+void CoreRing::close(const int connection, const uint64_t tag) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode    = IORING_OP_CLOSE;
+	entry -> fd        = connection;
+	entry -> user_data = tag;
+}
+
+/**
+ * Wait for poll events.
+ * @param file      Descriptor.
+ * @param events    Poll events, for example POLLIN.
+ * @param multishot Wether to keep polling after the first event.
+ * @param tag       Completion tag.
+ */
+void CoreRing::poll(const int file, const unsigned int events, const bool multishot, const uint64_t tag) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode        = IORING_OP_POLL_ADD;
+	entry -> fd            = file;
+	entry -> poll32_events = events;
+	entry -> len           = multishot ? IORING_POLL_ADD_MULTI : 0;
+	entry -> user_data     = tag;
+}
+
+/**
+ * Cancel pending operation.
+ * @param target Tag of the operation.
+ * @param tag    Completion tag of the cancellation.
+ */
+void CoreRing::cancel(const uint64_t target, const uint64_t tag) {
+	io_uring_sqe *entry = this -> next();
+	entry -> opcode    = IORING_OP_ASYNC_CANCEL;
+	entry -> fd        = -1;
+	entry -> addr      = target;
+	entry -> user_data = tag;
+}
+
+/**
+ * Submit prepared operations and wait for at least one completion.
+ * @param timeout_ms Longest wait.
+ * @return number of submitted operations, -1 with errno on failure, timeouts are no failure.
+ */
+int CoreRing::wait(const unsigned int timeout_ms) {
+	__kernel_timespec timeout = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000ll};
+
+	io_uring_getevents_arg argument = {};
+	argument.ts = reinterpret_cast<uint64_t>(&timeout);
+
+	int submitted = this -> enter(this -> queued, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &argument, sizeof(argument));
+	if (submitted == -1 && (errno == ETIME || errno == EINTR || errno == EBUSY)) return 0;
+
+	return submitted;
+}
+
+/**
+ * Enter kernel to submit and wait.
+ * @param submit        Operations to submit.
+ * @param wait          Completions to wait for.
+ * @param flags         Enter flags.
+ * @param argument      Extended argument.
+ * @param argument_size Size of the argument.
+ * @return submitted operations or -1.
+ */
+int CoreRing::enter(const unsigned int submit, const unsigned int wait, const unsigned int flags, const void *argument, const size_t argument_size) {
+	int submitted = syscall(__NR_io_uring_enter, this -> ring, submit, wait, flags, argument, argument_size);
+
+	if (submitted > 0) {
+		this -> queued -= std::min<unsigned int>(submitted, this -> queued);
+	}
+
+	return submitted;
+}
@@ -0,0 +1,97 @@
+#ifndef CORE_RING_HPP
+#define CORE_RING_HPP
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * io_uring submission and completion queues set up with raw system calls,
+ * with one group of provided receive buffers. Submissions are only prepared
+ * until the next wait, which submits them all with a single system call.
+ */
+class CoreRing {
+	public:
+		CoreRing(const unsigned int entries = 1024, const unsigned int buffers = 128, const unsigned int buffer_size = 16384);
+		CoreRing(const CoreRing&) = delete;
+		CoreRing &operator=(const CoreRing&) = delete;
+		~CoreRing();
+
+		bool isReady() const;
+
+		// Submissions, tag comes back with every completion.
+		void accept(const int server, const uint64_t tag);
+		void receive(const int connection, const uint64_t tag);
+		void send(const int connection, const msghdr *message, const uint64_t tag, const bool link = false);
+		void close(const int connection, const uint64_t tag);
+		void poll(const int file, const unsigned int events, const bool multishot, const uint64_t tag);
+		void cancel(const uint64_t target, const uint64_t tag);
+
+		int wait(const unsigned int timeout_ms);
+
+		template <typename Function> void complete(Function function);
+
+		// Provided receive buffers.
+		std::string_view buffer(const io_uring_cqe &completion) const;
+		void recycle(const io_uring_cqe &completion);
+
+		static bool supported();
+
+	private:
+		static constexpr uint16_t buffer_group = 0;
+
+		int ring = -1;
+		unsigned int entries = 0;
+
+		// Submission queue.
+		void *sq_map  = nullptr;
+		size_t sq_map_size = 0;
+		unsigned int *sq_head  = nullptr;
+		unsigned int *sq_tail  = nullptr;
+		unsigned int *sq_mask  = nullptr;
+		unsigned int *sq_array = nullptr;
+		io_uring_sqe *sqes = nullptr;
+		size_t sqes_size = 0;
+		unsigned int tail = 0;
+		unsigned int queued = 0;
+
+		// Completion queue.
+		void *cq_map  = nullptr;
+		size_t cq_map_size = 0;
+		unsigned int *cq_head = nullptr;
+		unsigned int *cq_tail = nullptr;
+		unsigned int *cq_mask = nullptr;
+		io_uring_cqe *cqes = nullptr;
+
+		// Provided buffers, handed back to the kernel once their data is copied.
+		char *buffer_data = nullptr;
+		unsigned int buffer_count = 0;
+		unsigned int buffer_size  = 0;
+
+		void release();
+		io_uring_sqe *next();
+		int enter(const unsigned int submit, const unsigned int wait, const unsigned int flags, const void *argument, const size_t argument_size);
+		bool provide(const unsigned int count, const unsigned int size);
+		void add(const unsigned int id, const unsigned int count);
+};
+
+/**
+ * Handle every available completion, the queue slot is free before function runs.
+ * @param function Called with each completion.
+ */
+template <typename Function>
+void CoreRing::complete(Function function) {
+	unsigned int head = *this -> cq_head;
+
+	while (head != __atomic_load_n(this -> cq_tail, __ATOMIC_ACQUIRE)) {
+		io_uring_cqe completion = this -> cqes[head & *this -> cq_mask];
+		__atomic_store_n(this -> cq_head, ++head, __ATOMIC_RELEASE);
+
+		function(completion);
+	}
+}
+
+#endif
@@ -1,17 +1,171 @@
 #include <core/router/router.hpp>
+#include <core/buffer/buffer.hpp>
+#include <core/pool/pool.hpp>
 
+#include <array>
+#include <chrono>
 #include <string>
-#include <regex>
+#include <stdexcept>
 #include <iostream>
+#include <errno.h>
+#include <unistd.h>
 #include <sys/socket.h>
+#include <sys/time.h>
 
 /**
- * Add route to the list of routes.
- * @param url   of the route.
- * @param route method that responds to the connection.
+ * Get nanoseconds since start.
+ * @param started Start time.
  */
-void CoreRouter::route(const std::string &method, const std::string &url, void (*route)(const Request&, Response&)) {
-	this -> routes[method][url] = route;
+static uint64_t elapsed(const std::chrono::steady_clock::time_point &started) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+/**
+ * Add route to the method route trie.
+ * @param url      of the route, static text with ':param' segments and '*tail'.
+ * @param route    callable that responds to the connection.
+ * @param consumer method that receives body chunks before route responds, body is not kept.
+ */
+void CoreRouter::route(const std::string &method, const std::string &url, Handler route, CoreBody::Consumer consumer) {
+	this -> routes[method].insert(url, this -> handlers.size());
+	this -> handlers.push_back(std::move(route));
+	this -> patterns.emplace_back(method, url);
+	this -> consuming = this -> consuming || consumer;
+	this -> consumers.push_back(std::move(consumer));
+	this -> policies.emplace_back();
+
+	// Series index of route is its handler index + 1.
+	if (this -> metrics) {
+		this -> metrics -> add(method, url);
+	}
+}
+
+/**
+ * Add WebSocket route, requests upgrading to it get a socket instead of a response.
+ * @param url      of the route, static text with ':param' segments and '*tail'.
+ * @param handlers methods that handle events of the socket.
+ */
+void CoreRouter::socket(const std::string &url, CoreWebSocket::Handlers handlers) {
+	this -> sockets.insert(url, this -> listeners.size());
+	this -> listeners.push_back(std::move(handlers));
+}
+
+/**
+ * Measure every request, routes registered so far get their series now.
+ * @param metrics Metrics to record into, nullptr disables measuring.
+ */
+void CoreRouter::measure(std::unique_ptr<CoreMetrics> metrics) {
+	this -> metrics = std::move(metrics);
+
+	for (size_t route = 0; this -> metrics && route < this -> handlers.size(); route++) {
+		this -> metrics -> add(this -> patterns[route].first, this -> patterns[route].second);
+	}
+}
+
+/**
+ * Cache responses of the GET route, the cache is created on first use.
+ * @param url    of the route as it was added.
+ * @param policy TTL and request parts the response varies by.
+ */
+void CoreRouter::cacheRoute(const std::string &url, CoreCache::Policy policy) {
+	if (!this -> cache) {
+		this -> cache = std::make_unique<CoreCache>();
+	}
+
+	// Latest route added for url is the one the trie finds.
+	for (size_t route = this -> patterns.size(); route-- > 0;) {
+		if (this -> patterns[route].first == "GET" && this -> patterns[route].second == url) {
+			this -> direct = this -> direct || (policy.query.empty() && policy.headers.empty());
+			this -> policies[route] = std::move(policy);
+			return;
+		}
+	}
+
+	throw std::runtime_error("Error: No GET route to cache for " + url + ".");
+}
+
+/**
+ * Respond from the cache, on a miss run the handler and cache its response.
+ * Concurrent misses on pool threads wait for the first one instead of running
+ * the handler, reactor threads never block and run it themselves.
+ * @param route    Route index.
+ * @param request  Request.
+ * @param response Response.
+ */
+void CoreRouter::respondCached(const size_t route, const Request &request, Response &response) {
+	const CoreCache::Policy &policy = *this -> policies[route];
+
+	// Compressed and plain content are cached separately.
+	std::string_view encoding = this -> compression ? this -> compression -> negotiate(response.accept_encoding) : std::string_view();
+	std::string key = CoreCache::key(this -> patterns[route].first, request, policy, encoding);
+
+	CoreCache::Fill fill;
+	std::shared_ptr<const CoreCache::Entry> entry = this -> cache -> get(key, fill, CorePool::isPoolThread());
+
+	if (entry) {
+		response.sendCached(*entry);
+		return;
+	}
+
+	CoreCache::Entry captured;
+	captured.route = route;
+	if (fill.isActive()) response.capture = &captured;
+
+	this -> handlers[route](request, response);
+	response.capture = nullptr;
+
+	// Streamed, file and personal responses are not kept.
+	if (captured.head > 0) {
+		fill.store(std::move(captured), policy.ttl);
+	}
+}
+
+/**
+ * Get metrics of the router.
+ * @return metrics or nullptr when not measured.
+ */
+CoreMetrics *CoreRouter::getMetrics() const {
+	return this -> metrics.get();
+}
+
+/**
+ * Get body chunk consumer of the route matching method and path.
+ * @param method Request method.
+ * @param path   Request path.
+ * @return consumer or nullptr when route has none.
+ */
+const CoreBody::Consumer *CoreRouter::consumer(std::string_view method, std::string_view path) const {
+	auto found = this -> routes.find(method);
+	if (found == this -> routes.end()) return nullptr;
+
+	CoreTrie::Params params;
+	size_t route = found -> second.find(path, params);
+
+	return route != CoreTrie::none && this -> consumers[route] ? &this -> consumers[route] : nullptr;
+}
+
+/**
+ * Check wether any route streams its body to a consumer.
+ */
+bool CoreRouter::hasConsumers() const {
+	return this -> consuming;
+}
+
+/**
+ * Get handlers of the WebSocket route matching request path, captured params are set on request.
+ * @param request Upgrade request.
+ * @return handlers or nullptr when no WebSocket route matches.
+ */
+const CoreWebSocket::Handlers *CoreRouter::socket(Request &request) const {
+	size_t route = this -> sockets.find(request.getPath(), request.params);
+	return route != CoreTrie::none ? &this -> listeners[route] : nullptr;
+}
+
+/**
+ * Check wether any WebSocket route was added.
+ */
+bool CoreRouter::hasSockets() const {
+	return !this -> listeners.empty();
 }
 
 /**
@@ -19,60 +173,181 @@ void CoreRouter::route(const std::string &method, const std::string &url, void (
  * @param connection Client request.
  */
 void CoreRouter::respond(const int &connection) {
-	std::string headers;
-	char buffer = 0;
+	CoreBuffer buffer;
+
+	// Every read and write gives up after the timeout, the whole request has to arrive within it.
+	timeval timeout = {blocking_timeout, 0};
+	setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
 
-	// Read request headers.
-	while (recv(connection, &buffer, 1, (buffer == 0 ? 0 : MSG_DONTWAIT)) > 0) {
-		headers += buffer;
+	auto started = std::chrono::steady_clock::now();
+
+	// Read request in blocks until headers and body are complete.
+	while (!buffer.requestLength()) {
+		ssize_t size = buffer.receive(connection);
+
+		if (size == -1 && errno == EINTR) continue;
+
+		// Client too slow.
+		if ((size == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) || std::chrono::steady_clock::now() - started >= std::chrono::seconds(blocking_timeout)) {
+			this -> reject(connection, 408);
+			close(connection);
+			return;
+		}
+
+		if (size <= 0) break;
 	}
 
+	// Body length other parsers could read differently.
+	CoreFrame frame;
+	if (buffer.frame(frame) && frame.invalid) {
+		this -> reject(connection, 400);
+		close(connection);
+		return;
+	}
+
+	// Incomplete request is still parsed as far as it was read.
+	size_t length = buffer.requestLength();
+	this -> respond(connection, length ? buffer.view().substr(0, length) : buffer.view());
+
+	close(connection);
+}
+
+/**
+ * Respond to the already buffered request. Connection is left open for the caller.
+ * @param connection Client request.
+ * @param headers    Fully read request headers and body, has to outlive the response.
+ * @param keep_alive Wether connection may be kept open after this request.
+ * @param backlog    Output buffer for data the socket does not accept right away, blocks without one.
+ * @param body       Body received separately from headers.
+ * @param stream     Receives the response stream left open by the route, streams end with the route without it.
+ * @return true when client and server agreed to keep the connection open.
+ */
+bool CoreRouter::respond(const int &connection, std::string_view headers, const bool keep_alive, CoreOutput *backlog, const CoreBody *body, std::shared_ptr<CoreStream> *stream) {
+	CoreMetrics *metrics = this -> metrics.get();
+	std::array<uint64_t, CoreMetrics::Stages> stages = {};
+	auto started = metrics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+	size_t series = CoreMetrics::unmatched;
+
+	// Request and Response allocate from the arena of this thread, released once they are gone.
+	static thread_local CoreArena arena;
+	CoreArena::Scope scope(arena);
+
 	// Generate Request and Response.
-	Request request = Request(headers);
-	Response response = Response(connection);
+	Request request = Request(headers, body, arena.get());
+	Response response = Response(connection, arena.get());
+	response.backlog = backlog;
+	response.timed   = metrics != nullptr;
+
+	if (metrics) {
+		stages[CoreMetrics::Parse] = elapsed(started);
+	}
 
 	// Invalid Request.
 	if (!request.isValid()) {
 		response.status(404).send();
-		return;
+		if (metrics) metrics -> record(series, response.status_code, stages);
+		return false;
+	}
+
+	response.keep_alive = keep_alive && request.isKeepAlive();
+	response.compression = this -> compression.get();
+	response.accept_encoding = request.getHeader("Accept-Encoding");
+	response.chunked = request.getVersion() == "HTTP/1.1";
+	response.queued  = stream != nullptr;
+
+	// HEAD is answered by GET routes without content.
+	response.head_only = request.getMethod() == "HEAD";
+
+	// HEAD is routed to GET routes when there are no HEAD routes.
+	std::string_view name = response.head_only && !this -> routes.contains("HEAD") ? "GET" : request.getMethod();
+
+	// Cached responses of routes varying by path alone skip routing, params are not captured for them.
+	std::shared_ptr<const CoreCache::Entry> hit;
+	if (this -> direct && this -> cache && name == "GET") {
+		static const CoreCache::Policy path_only = {};
+		std::string_view encoding = this -> compression ? this -> compression -> negotiate(response.accept_encoding) : std::string_view();
+		hit = this -> cache -> peek(CoreCache::key(name, request, path_only, encoding));
 	}
 
 	// Check if method is allowed.
-	if (this -> routes.find(request.getMethod()) != this -> routes.end()) {
-		auto routes = this -> routes.at(request.getMethod());
-
-		// Check if route is allowed.
-		// route -> first is route regex.
-		// route -> second is route method to use for routing.
-		for (auto route = routes.begin(); route != routes.end(); route++) {
-			// Route is defined with regex.
-			if (route -> first.find("*") != std::string::npos) {
-				std::regex r(route -> first);
-				std::smatch match;
-				std::regex_search(request.getURL(), match, r);
-
-				// Route regex matches request url.
-				if (match.size() > 0) {
-					this -> routes.at(request.getMethod()).at(route -> first)(request, response);
-
-					// Route found, break routes looping.
-					break;
-				}
-
-			// Route is specific.
-			} else if (request.getURL() == route -> first) {
-				this -> routes.at(request.getMethod()).at(route -> first)(request, response);
-				break;
-			}
+	size_t route = hit ? hit -> route : CoreTrie::none;
+	auto method = hit ? this -> routes.end() : this -> routes.find(name);
+	if (hit) {
+		series = route + 1;
+	} else if (method != this -> routes.end()) {
+		route = method -> second.find(request.getPath(), request.params);
+
+		if (metrics) {
+			stages[CoreMetrics::Route] = elapsed(started) - stages[CoreMetrics::Parse];
+		}
+
+		if (route != CoreTrie::none) {
+			series = route + 1;
 		}
+	}
 
-		// Invalid route or invalid route handler. Respond with 404.
-		if (!response.isSent()) {
-			response.status(404).send();
+	// Route found, captured params are set on request.
+	auto handle = [this, route, &hit](const Request &request, Response &response) {
+		if (hit) {
+			response.sendCached(*hit);
+		} else if (route != CoreTrie::none && this -> policies[route] && this -> cache) {
+			this -> respondCached(route, request, response);
+		} else if (route != CoreTrie::none) {
+			this -> handlers[route](request, response);
 		}
+	};
 
-	// Invalid method. Respond with 404.
+	// Middleware runs for unmatched requests too, so it may answer preflights and the like.
+	if (this -> middleware.isEmpty()) {
+		handle(request, response);
 	} else {
+		this -> middleware.run(request, response, handle);
+	}
+
+	// Invalid method, route or route handler. Respond with 404.
+	if (!response.isSent()) {
 		response.status(404).send();
 	}
+
+	// Handler time excludes time spent writing to the socket.
+	if (metrics) {
+		stages[CoreMetrics::Write]   = response.write_time;
+		stages[CoreMetrics::Handler] = elapsed(started) - stages[CoreMetrics::Parse] - stages[CoreMetrics::Route] - response.write_time;
+		metrics -> record(series, response.status_code, stages);
+	}
+
+	// Stream outlives the route only when the caller takes it over.
+	if (response.streaming) {
+		if (stream) {
+			*stream = std::move(response.streaming);
+		} else {
+			response.streaming -> end();
+			response.streaming -> close();
+		}
+	}
+
+	return response.keep_alive;
+}
+
+/**
+ * Reject request without routing it, connection has to be closed after.
+ * @param connection  Client request.
+ * @param status      HTTP status code.
+ * @param retry_after Seconds the client should wait before retrying, 0 to omit.
+ * @param backlog     Output buffer for data the socket does not accept right away.
+ */
+void CoreRouter::reject(const int &connection, const unsigned int status, const unsigned int retry_after, CoreOutput *backlog) {
+	Response response = Response(connection);
+	response.backlog = backlog;
+
+	if (retry_after > 0) {
+		response.header("Retry-After", std::to_string(retry_after));
+	}
+
+	response.status(status).send();
+
+	if (this -> metrics) {
+		this -> metrics -> reject(status);
+	}
 }
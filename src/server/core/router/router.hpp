@@ -3,17 +3,66 @@
 
 #include <core/headers/request.hpp>
 #include <core/headers/response.hpp>
+#include <core/router/trie.hpp>
+#include <core/body/body.hpp>
+#include <core/metrics/metrics.hpp>
+#include <core/cache/cache.hpp>
+#include <core/arena/arena.hpp>
+#include <core/websocket/websocket.hpp>
+#include <core/middleware/middleware.hpp>
 
+#include <deque>
 #include <string>
+#include <string_view>
 #include <map>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
 
 class CoreRouter {
 	public:
+		using Handler = std::function<void(const Request&, Response&)>;
+
 		void respond(const int &connection);
+		bool respond(const int &connection, std::string_view headers, const bool keep_alive = false, CoreOutput *backlog = nullptr, const CoreBody *body = nullptr, std::shared_ptr<CoreStream> *stream = nullptr);
+		void reject(const int &connection, const unsigned int status, const unsigned int retry_after = 0, CoreOutput *backlog = nullptr);
+		const CoreBody::Consumer *consumer(std::string_view method, std::string_view path) const;
+		bool hasConsumers() const;
+		const CoreWebSocket::Handlers *socket(Request &request) const;
+		bool hasSockets() const;
+		CoreMetrics *getMetrics() const;
 
 	private:
-		void route(const std::string &method, const std::string &url, void (*route)(const Request &request, Response &response));
-		std::map<std::string, std::map<std::string, void (*)(const Request&, Response&)>> routes;
+		// Seconds a blocking connection gets to send its request and to read the response.
+		static constexpr int blocking_timeout = 10;
+
+		std::unique_ptr<CoreCompress> compression;
+		std::unique_ptr<CoreMetrics> metrics;
+		std::unique_ptr<CoreCache> cache;
+		CoreMiddleware middleware;
+
+		void measure(std::unique_ptr<CoreMetrics> metrics);
+		void cacheRoute(const std::string &url, CoreCache::Policy policy);
+		void respondCached(const size_t route, const Request &request, Response &response);
+		void route(const std::string &method, const std::string &url, Handler route, CoreBody::Consumer consumer = nullptr);
+		void socket(const std::string &url, CoreWebSocket::Handlers handlers);
+
+		// Route tries per method, trie values index handlers.
+		std::map<std::string, CoreTrie, std::less<>> routes;
+		std::vector<Handler> handlers;
+		std::vector<CoreBody::Consumer> consumers;
+		std::vector<std::optional<CoreCache::Policy>> policies;
+		std::vector<std::pair<std::string, std::string>> patterns;
+		bool consuming = false;
+
+		// Some cached route varies by path alone, its responses are looked up before routing.
+		bool direct = false;
+
+		// WebSocket routes, handlers stay in place for the sockets using them.
+		CoreTrie sockets;
+		std::deque<CoreWebSocket::Handlers> listeners;
 
 	friend class CoreServer;
 };
@@ -0,0 +1,161 @@
+#include <core/router/trie.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+/**
+ * Add route pattern to the trie, same pattern replaces earlier route.
+ * @param pattern Route pattern, for example "/users/:id".
+ * @param route   Route index returned by find.
+ */
+void CoreTrie::insert(std::string_view pattern, const size_t route) {
+	this -> insert(this -> root, pattern, route);
+}
+
+/**
+ * Insert rest of the pattern below node.
+ * @param node    Node that already matches everything before pattern.
+ * @param pattern Rest of the route pattern.
+ * @param route   Route index.
+ */
+void CoreTrie::insert(Node &node, std::string_view pattern, const size_t route) {
+	// Pattern fully consumed.
+	if (pattern.empty()) {
+		node.route = route;
+		return;
+	}
+
+	// Named param until the next '/'.
+	if (pattern.front() == ':') {
+		size_t end = pattern.find('/');
+		std::string_view name = pattern.substr(1, end == std::string_view::npos ? end : end - 1);
+
+		if (!node.param) {
+			node.param = std::make_unique<Node>();
+			node.param -> label = name;
+		} else if (node.param -> label != name) {
+			throw std::invalid_argument("Error: Route param :" + std::string(name) + " conflicts with :" + node.param -> label + ".");
+		}
+
+		this -> insert(*node.param, end == std::string_view::npos ? std::string_view() : pattern.substr(end), route);
+		return;
+	}
+
+	// Tail captures the rest of the path.
+	if (pattern.front() == '*') {
+		if (!node.tail) {
+			node.tail = std::make_unique<Node>();
+		}
+
+		node.tail -> label = pattern.substr(1);
+		node.tail -> route = route;
+		return;
+	}
+
+	// Static text until the next param or tail.
+	size_t end = std::min(pattern.find(':'), pattern.find('*'));
+	Node &child = this -> insertStatic(node, pattern.substr(0, end));
+	this -> insert(child, end == std::string_view::npos ? std::string_view() : pattern.substr(end), route);
+}
+
+/**
+ * Find or create static child matching text, splitting shared prefixes.
+ * @param node Parent node.
+ * @param text Static text below parent.
+ * @return node that matches the whole text.
+ */
+CoreTrie::Node &CoreTrie::insertStatic(Node &node, std::string_view text) {
+	size_t index = node.indices.find(text.front());
+
+	// No child shares first character.
+	if (index == std::string::npos) {
+		auto child = std::make_unique<Node>();
+		child -> label = text;
+		node.indices += text.front();
+		node.statics.push_back(std::move(child));
+		return *node.statics.back();
+	}
+
+	Node &child = *node.statics[index];
+	size_t common = 0;
+	while (common < text.length() && common < child.label.length() && text[common] == child.label[common]) {
+		common++;
+	}
+
+	// Child label is longer than shared prefix, split it.
+	if (common < child.label.length()) {
+		auto split = std::make_unique<Node>();
+		split -> label = child.label.substr(0, common);
+
+		child.label = child.label.substr(common);
+		split -> indices += child.label.front();
+		split -> statics.push_back(std::move(node.statics[index]));
+		node.statics[index] = std::move(split);
+	}
+
+	Node &prefix = *node.statics[index];
+	return common < text.length() ? this -> insertStatic(prefix, text.substr(common)) : prefix;
+}
+
+/**
+ * Find route for path.
+ * @param path   Request path.
+ * @param params Captured params, views into path and the trie.
+ * @return route index or none.
+ */
+size_t CoreTrie::find(std::string_view path, Params &params) const {
+	size_t route = none;
+	params.clear();
+
+	this -> find(this -> root, path, params, route);
+	return route;
+}
+
+/**
+ * Match rest of the path below node, backtracking from static to param to tail.
+ * @param node   Node that already matches everything before path.
+ * @param path   Rest of the request path.
+ * @param params Captured params.
+ * @param route  Found route index.
+ * @return true when route was found.
+ */
+bool CoreTrie::find(const Node &node, std::string_view path, Params &params, size_t &route) const {
+	if (path.empty() && node.route != none) {
+		route = node.route;
+		return true;
+	}
+
+	// Static child.
+	if (!path.empty()) {
+		size_t index = node.indices.find(path.front());
+
+		if (index != std::string::npos) {
+			const Node &child = *node.statics[index];
+
+			if (path.starts_with(child.label) && this -> find(child, path.substr(child.label.length()), params, route)) {
+				return true;
+			}
+		}
+	}
+
+	// Param child, never empty.
+	if (node.param && !path.empty() && path.front() != '/') {
+		size_t end = std::min(path.find('/'), path.length());
+		params.emplace_back(node.param -> label, path.substr(0, end));
+
+		if (this -> find(*node.param, path.substr(end), params, route)) {
+			return true;
+		}
+
+		params.pop_back();
+	}
+
+	// Tail child.
+	if (node.tail) {
+		params.emplace_back(node.tail -> label, path);
+		route = node.tail -> route;
+		return true;
+	}
+
+	return false;
+}
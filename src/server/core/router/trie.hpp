@@ -0,0 +1,43 @@
+#ifndef CORE_TRIE_HPP
+#define CORE_TRIE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+/**
+ * Radix trie of route patterns built once at registration. Patterns are
+ * made of static text, named ':param' segments and a '*name' tail.
+ * Lookup walks the path once, static text wins over params and params over tails.
+ */
+class CoreTrie {
+	public:
+		using Params = std::pmr::vector<std::pair<std::string_view, std::string_view>>;
+
+		static constexpr size_t none = static_cast<size_t>(-1);
+
+		void insert(std::string_view pattern, const size_t route);
+		size_t find(std::string_view path, Params &params) const;
+
+	private:
+		struct Node {
+			std::string label;
+			std::string indices;
+			std::vector<std::unique_ptr<Node>> statics;
+			std::unique_ptr<Node> param;
+			std::unique_ptr<Node> tail;
+			size_t route = none;
+		};
+
+		Node root;
+
+		void insert(Node &node, std::string_view pattern, const size_t route);
+		Node &insertStatic(Node &node, std::string_view text);
+		bool find(const Node &node, std::string_view path, Params &params, size_t &route) const;
+};
+
+#endif
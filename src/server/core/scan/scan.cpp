@@ -0,0 +1,266 @@
+#include <core/scan/scan.hpp>
+
+#include <array>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define CORE_SCAN_X86
+#endif
+
+/**
+ * Build table of token characters: letters, digits and !#$%&'*+-.^_`|~.
+ */
+static constexpr std::array<bool, 256> tokenTable() {
+	std::array<bool, 256> table = {};
+	std::string_view symbols = "!#$%&'*+-.^_`|~";
+
+	for (size_t c = 0; c < 256; c++) {
+		table[c] = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || symbols.find(char(c)) != std::string_view::npos;
+	}
+
+	return table;
+}
+
+/**
+ * Build table of field value characters: everything but controls other than tab.
+ */
+static constexpr std::array<bool, 256> valueTable() {
+	std::array<bool, 256> table = {};
+
+	for (size_t c = 0; c < 256; c++) {
+		table[c] = c == '\t' || (c >= 0x20 && c != 0x7f);
+	}
+
+	return table;
+}
+
+static constexpr std::array<bool, 256> tokens = tokenTable();
+static constexpr std::array<bool, 256> values = valueTable();
+
+/**
+ * Count leading bytes of data that are in the table.
+ * @param table  Character class.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+static size_t scan(const std::array<bool, 256> &table, const char *data, const size_t length) {
+	size_t i = 0;
+	while (i < length && table[static_cast<uint8_t>(data[i])]) i++;
+	return i;
+}
+
+/**
+ * Count leading token characters one byte at a time.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+static size_t tokenScalar(const char *data, const size_t length) {
+	return scan(tokens, data, length);
+}
+
+/**
+ * Count leading field value characters one byte at a time.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+static size_t valueScalar(const char *data, const size_t length) {
+	return scan(values, data, length);
+}
+
+#ifdef CORE_SCAN_X86
+
+/**
+ * Build nibble table of token characters for byte shuffles: entry for the
+ * low nibble has bit h set when byte h << 4 | low is a token character.
+ * Bytes from 0x80 are never token characters, their high nibble has no bit.
+ */
+static constexpr std::array<uint8_t, 16> tokenNibbles() {
+	std::array<uint8_t, 16> nibbles = {};
+
+	for (size_t c = 0; c < 128; c++) {
+		if (tokens[c]) nibbles[c & 0x0f] |= uint8_t(1 << (c >> 4));
+	}
+
+	return nibbles;
+}
+
+alignas(16) static constexpr std::array<uint8_t, 16> token_low  = tokenNibbles();
+alignas(16) static constexpr std::array<uint8_t, 16> token_high = {1, 2, 4, 8, 16, 32, 64, 128, 0, 0, 0, 0, 0, 0, 0, 0};
+
+/**
+ * Count leading token characters 32 bytes at a time, nibbles of every byte
+ * pick bits from the token table with byte shuffles.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+__attribute__((target("avx2")))
+static size_t tokenAvx2(const char *data, const size_t length) {
+	const __m256i low    = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(token_low.data())));
+	const __m256i high   = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(token_high.data())));
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+		__m256i lows  = _mm256_shuffle_epi8(low, _mm256_and_si256(block, nibble));
+		__m256i highs = _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+
+		// Bytes whose nibble bits do not meet are not token characters.
+		uint32_t other = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lows, highs), _mm256_setzero_si256()));
+		if (other) return i + __builtin_ctz(other);
+	}
+
+	return i + tokenScalar(data + i, length - i);
+}
+
+/**
+ * Count leading field value characters 32 bytes at a time.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+__attribute__((target("avx2")))
+static size_t valueAvx2(const char *data, const size_t length) {
+	const __m256i control = _mm256_set1_epi8(0x1f);
+	const __m256i tab     = _mm256_set1_epi8('\t');
+	const __m256i del     = _mm256_set1_epi8(0x7f);
+	size_t i = 0;
+
+	for (; i + 32 <= length; i += 32) {
+		__m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+		// Controls are bytes up to 0x1f, tab excepted, and DEL.
+		__m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(block, control), block);
+		controls = _mm256_andnot_si256(_mm256_cmpeq_epi8(block, tab), controls);
+		controls = _mm256_or_si256(controls, _mm256_cmpeq_epi8(block, del));
+
+		uint32_t other = _mm256_movemask_epi8(controls);
+		if (other) return i + __builtin_ctz(other);
+	}
+
+	return i + valueScalar(data + i, length - i);
+}
+
+/**
+ * Count leading token characters 16 bytes at a time.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+__attribute__((target("sse4.2")))
+static size_t tokenSse42(const char *data, const size_t length) {
+	const __m128i low    = _mm_load_si128(reinterpret_cast<const __m128i*>(token_low.data()));
+	const __m128i high   = _mm_load_si128(reinterpret_cast<const __m128i*>(token_high.data()));
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	size_t i = 0;
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		__m128i lows  = _mm_shuffle_epi8(low, _mm_and_si128(block, nibble));
+		__m128i highs = _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+
+		uint32_t other = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lows, highs), _mm_setzero_si128()));
+		if (other) return i + __builtin_ctz(other);
+	}
+
+	return i + tokenScalar(data + i, length - i);
+}
+
+/**
+ * Count leading field value characters 16 bytes at a time, controls are
+ * found by range comparison of the string instructions.
+ * @param data   Data.
+ * @param length Length of data.
+ */
+__attribute__((target("sse4.2")))
+static size_t valueSse42(const char *data, const size_t length) {
+	// Ranges of controls other than tab, and DEL.
+	alignas(16) static const char ranges[16] = "\x00\x08\x0a\x1f\x7f\x7f";
+	const __m128i range = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+	size_t i = 0;
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		int found = _mm_cmpestri(range, 6, block, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+		if (found < 16) return i + found;
+	}
+
+	return i + valueScalar(data + i, length - i);
+}
+
+#endif
+
+/**
+ * Count leading token characters, as methods and field names are made of.
+ * @param text Text.
+ * @return length of the token, position of the first other character.
+ */
+size_t CoreScan::token(std::string_view text) {
+	return active().token(text.data(), text.length());
+}
+
+/**
+ * Count leading field value characters, the value ends at CR, LF or another control.
+ * @param text Text.
+ * @return length of the value, position of the first control character.
+ */
+size_t CoreScan::value(std::string_view text) {
+	return active().value(text.data(), text.length());
+}
+
+/**
+ * Use other kernels, for benchmarks and for checking the fallbacks.
+ * @param kernels "avx2", "sse4.2" or "scalar".
+ * @return false when the CPU does not support them.
+ */
+bool CoreScan::use(std::string_view kernels) {
+	if (kernels == "scalar") {
+		active() = {tokenScalar, valueScalar, "scalar"};
+		return true;
+	}
+
+#ifdef CORE_SCAN_X86
+	__builtin_cpu_init();
+
+	if (kernels == "avx2" && __builtin_cpu_supports("avx2")) {
+		active() = {tokenAvx2, valueAvx2, "avx2"};
+		return true;
+	}
+
+	if (kernels == "sse4.2" && __builtin_cpu_supports("sse4.2")) {
+		active() = {tokenSse42, valueSse42, "sse4.2"};
+		return true;
+	}
+#endif
+
+	return false;
+}
+
+/**
+ * Get name of the kernels in use.
+ */
+std::string_view CoreScan::kernels() {
+	return active().name;
+}
+
+/**
+ * Get kernels in use, the widest the CPU supports are chosen on first use.
+ */
+CoreScan::Kernels &CoreScan::active() {
+	static Kernels kernels = [] {
+		Kernels chosen = {tokenScalar, valueScalar, "scalar"};
+
+#ifdef CORE_SCAN_X86
+		__builtin_cpu_init();
+
+		if (__builtin_cpu_supports("avx2")) {
+			chosen = {tokenAvx2, valueAvx2, "avx2"};
+		} else if (__builtin_cpu_supports("sse4.2")) {
+			chosen = {tokenSse42, valueSse42, "sse4.2"};
+		}
+#endif
+
+		return chosen;
+	}();
+
+	return kernels;
+}
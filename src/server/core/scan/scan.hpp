@@ -0,0 +1,32 @@
+#ifndef CORE_SCAN_HPP
+#define CORE_SCAN_HPP
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Character class scanning of request lines and header fields. Kernels
+ * check 32 bytes at a time with AVX2 or 16 with SSE4.2, whichever the CPU
+ * supports, and fall back to table lookups. Kernels are chosen once at runtime.
+ */
+class CoreScan {
+	public:
+		static size_t token(std::string_view text);
+		static size_t value(std::string_view text);
+
+		static bool use(std::string_view kernels);
+		static std::string_view kernels();
+
+	private:
+		using Kernel = size_t (*)(const char *data, const size_t length);
+
+		struct Kernels {
+			Kernel token;
+			Kernel value;
+			std::string_view name;
+		};
+
+		static Kernels &active();
+};
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef CORE_OPTIONS_HPP
+#define CORE_OPTIONS_HPP
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Server connection handling options shared by every worker.
+ */
+struct CoreOptions {
+	// Seconds an idle keep-alive connection stays open.
+	unsigned int keep_alive_timeout  = 5;
+
+	// Requests served on one connection before it is closed.
+	unsigned int keep_alive_requests = 100;
+
+	// Seconds to receive request line and headers, body progress and write progress before
+	// the connection is closed, 408 is sent for incomplete requests. 0 disables the timeout.
+	unsigned int header_timeout = 10;
+	unsigned int body_timeout   = 30;
+	unsigned int write_timeout  = 30;
+
+	// Open connections of the server and of one client address, 0 for no limit.
+	// New connections above the limit get 503 or 429 and are closed.
+	size_t max_connections             = 0;
+	size_t max_connections_per_address = 0;
+
+	// Request line and headers size limit, larger requests get 431.
+	size_t max_header_size = 16384;
+
+	// Request body size limit, larger bodies get 413.
+	size_t max_body_size = 8388608;
+
+	// Bodies above this size are streamed to a temporary file in body_directory.
+	size_t body_spill_size = 1048576;
+	std::string body_directory = "/tmp";
+
+	// Handler pool threads, 0 runs handlers on the reactor threads.
+	unsigned int pool_threads = 0;
+
+	// Requests waiting for a handler thread before new ones get 503.
+	size_t pool_queue = 1024;
+
+	// Use io_uring instead of epoll for accepting, receiving and sending, when the kernel supports it.
+	bool io_uring = false;
+
+	// Accept HTTP/2 without TLS from clients sending its preface or upgrading to h2c.
+	bool http2 = false;
+
+	// Seconds to finish in-flight requests after stop before connections are closed.
+	unsigned int shutdown_timeout = 30;
+};
+
+#endif
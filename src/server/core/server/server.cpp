@@ -1,4 +1,7 @@
 #include <core/server/server.hpp>
+#include <core/reactor/reactor.hpp>
+#include <core/static/static.hpp>
+#include <core/ring/ring.hpp>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -8,46 +11,493 @@
 #include <ostream>
 #include <unistd.h>
 #include <thread>
+#include <vector>
+#include <memory>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/eventfd.h>
+#include <sys/un.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
 
-/**
- * Static respond function for router to respond to connection in new thread.
- * @param router     Router to use.
- * @param connection Connection to respond to.
- */
-void respond(CoreRouter &router, int connection) {
-	router.respond(connection);
-}
+// Stop events of running servers plus one, written by the signal handler. Zero is a free slot.
+static std::array<std::atomic<int>, 16> stop_events;
 
 /**
- * Create new server and start listening for connections.
+ * Create new server, it starts listening for connections on start.
  * @param port        Port to listen on.
  * @param connections Number of parallel allowed connections.
+ * @param workers     Number of reactor threads, each with its own listener.
  */
-CoreServer::CoreServer(CoreRouter &router, const unsigned int port, const unsigned int connections):
-	router(router), port(port), connections(connections) {
-		this -> createSocket(this -> server);
-		this -> configureSocket(this -> server);
+CoreServer::CoreServer(CoreRouter &router, const unsigned int port, const unsigned int connections, const unsigned int workers):
+	router(router), port(port), connections(connections), workers(workers > 0 ? workers : 1) {
 		this -> createAddress(this -> address, this -> address_size);
-		this -> bindSocketAddress(this -> server, this -> address);
-		this -> startListener(this -> server);
+
+		this -> stop_event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (this -> stop_event == -1) {
+			perror("Unable to create stop event: ");
+			exit(EXIT_FAILURE);
+		}
+}
+
+/**
+ * Close listeners and stop event.
+ */
+CoreServer::~CoreServer() {
+	for (int listener : this -> listeners) {
+		::close(listener);
+	}
+
+	::close(this -> stop_event);
 }
 
 /**
  * Server GET method startpoint.
  * @param url   Request url.
- * @param route Route method.
+ * @param route Route function, lambda or CoreChain.
  */
-void CoreServer::get(const std::string &url, void (*route)(const Request&, Response&)) {
-	router.route("GET", url, route);
+void CoreServer::get(const std::string &url, CoreRouter::Handler route) {
+	router.route("GET", url, std::move(route));
 }
 
 /**
  * Server POST method startpoint.
  * @param url   Request url.
- * @param route Route method.
+ * @param route Route function, lambda or CoreChain.
+ */
+void CoreServer::post(const std::string &url, CoreRouter::Handler route) {
+	router.route("POST", url, std::move(route));
+}
+
+/**
+ * Server GET method startpoint with fixed content.
+ * @param url     Request url.
+ * @param content Content to respond with.
+ */
+void CoreServer::get(const std::string &url, const std::string &content) {
+	router.route("GET", url, [content](const Request&, Response &response) {
+		response.sendView(content);
+	});
+}
+
+/**
+ * Server POST method startpoint with fixed content.
+ * @param url     Request url.
+ * @param content Content to respond with.
+ */
+void CoreServer::post(const std::string &url, const std::string &content) {
+	router.route("POST", url, [content](const Request&, Response &response) {
+		response.sendView(content);
+	});
+}
+
+/**
+ * Server POST method startpoint receiving its body piece by piece.
+ * Consumer gets every body chunk as it arrives, returning false answers 400.
+ * Route runs once the body is complete.
+ * @param url      Request url.
+ * @param consumer Body chunk consumer.
+ * @param route    Route function.
+ */
+void CoreServer::upload(const std::string &url, CoreBody::Consumer consumer, CoreRouter::Handler route) {
+	router.route("POST", url, std::move(route), std::move(consumer));
+}
+
+/**
+ * Server WebSocket startpoint, GET requests upgrading to websocket get a
+ * socket instead of a response. Handlers run on the reactor thread in the
+ * order events arrive, keep them short and send from other threads instead
+ * of waiting. Messages larger than the body limit close the socket with 1009.
+ * @param url      Request url.
+ * @param handlers Open, message and close handlers.
+ */
+void CoreServer::websocket(const std::string &url, CoreWebSocket::Handlers handlers) {
+	router.socket(url, std::move(handlers));
+}
+
+/**
+ * Run layer around every routed request, after the layers added before it.
+ * Layers are called as layer(request, response, next) and skip the route by
+ * responding without calling next. Requests matching no route pass through
+ * the layers too before they get 404. Routes needing their own layers can be
+ * wrapped in a CoreChain instead, which costs nothing at runtime.
+ * @param layer Middleware layer.
+ * @return      self.
+ */
+CoreServer &CoreServer::use(CoreMiddleware::Layer layer) {
+	router.middleware.use(std::move(layer));
+	return *this;
+}
+
+/**
+ * Compress responses, for example server.compress(std::make_unique<CoreCompress>(512)).
+ * @param compression Compression stage, nullptr disables compression.
+ * @return            self.
+ */
+CoreServer &CoreServer::compress(std::unique_ptr<CoreCompress> compression) {
+	router.compression = std::move(compression);
+	return *this;
+}
+
+/**
+ * Replace response cache, for example server.cache(std::make_unique<CoreCache>(268435456)).
+ * @param cache Cache of the routes marked cacheable, nullptr disables caching.
+ * @return      self.
+ */
+CoreServer &CoreServer::cache(std::unique_ptr<CoreCache> cache) {
+	router.cache = std::move(cache);
+	return *this;
+}
+
+/**
+ * Cache serialized responses of a GET route added before, hits skip the handler.
+ * Only 200 responses without cookies and not marked private or no-store are kept.
+ * @param url     Route url as it was added.
+ * @param ttl     Seconds a response stays fresh.
+ * @param query   Query values the response varies by.
+ * @param headers Request headers the response varies by.
+ * @return        self.
+ */
+CoreServer &CoreServer::cache(const std::string &url, const unsigned int ttl, const std::vector<std::string> &query, const std::vector<std::string> &headers) {
+	router.cacheRoute(url, {std::chrono::seconds(ttl), query, headers});
+	return *this;
+}
+
+/**
+ * Serve static files of directory below url.
+ * @param url        Mount url, for example "/assets".
+ * @param directory  Directory to serve files from.
+ * @param cache_file Largest file size kept in memory, larger files use sendfile.
+ * @param cache_size Memory limit of all cached files.
+ * @return           self.
+ */
+CoreServer &CoreServer::serve(const std::string &url, const std::string &directory, const size_t cache_file, const size_t cache_size) {
+	auto files = std::make_shared<CoreStatic>(directory, cache_file, cache_size);
+	auto route = [files](const Request &request, Response &response) {
+		files -> serve(request, response);
+	};
+
+	std::string mount = url;
+	while (!mount.empty() && mount.back() == '/') mount.pop_back();
+
+	router.route("GET", mount.empty() ? "/" : mount, route);
+	router.route("GET", mount + "/*path", route);
+	return *this;
+}
+
+/**
+ * Configure persistent connections.
+ * @param timeout  Seconds an idle connection stays open.
+ * @param requests Requests served on one connection before it is closed.
+ * @return         self.
+ */
+CoreServer &CoreServer::keepAlive(const unsigned int timeout, const unsigned int requests) {
+	this -> options.keep_alive_timeout  = timeout;
+	this -> options.keep_alive_requests = requests;
+	return *this;
+}
+
+/**
+ * Close connections stuck in one phase, incomplete requests get 408 first.
+ * Headers have to arrive within their timeout as a whole, body and write
+ * timeouts count from the last progress. 0 disables a timeout.
+ * @param header Seconds to receive request line and headers.
+ * @param body   Seconds without body progress.
+ * @param write  Seconds without write progress.
+ * @return       self.
+ */
+CoreServer &CoreServer::timeouts(const unsigned int header, const unsigned int body, const unsigned int write) {
+	this -> options.header_timeout = header;
+	this -> options.body_timeout   = body;
+	this -> options.write_timeout  = write;
+	return *this;
+}
+
+/**
+ * Cap open connections, connections above the cap are answered on accept and closed.
+ * @param total       Open connections of the server, 503 above it, 0 for no limit.
+ * @param per_address Open connections of one client address, 429 above it, 0 for no limit.
+ * @return            self.
+ */
+CoreServer &CoreServer::connectionLimit(const size_t total, const size_t per_address) {
+	this -> options.max_connections             = total;
+	this -> options.max_connections_per_address = per_address;
+	return *this;
+}
+
+/**
+ * Limit requests of every client address with a token bucket, IPv6 clients by their /64 prefix.
+ * Requests over the limit get 429 with Retry-After before they are parsed, the connection closes.
+ * @param rate  Requests per second.
+ * @param burst Requests allowed at once after being idle.
+ * @return      self.
+ */
+CoreServer &CoreServer::rateLimit(const unsigned int rate, const unsigned int burst) {
+	if (!this -> rate_limit) {
+		this -> rate_limit = std::make_unique<CoreRateLimit>();
+	}
+
+	this -> rate_limit -> limit(rate, burst);
+	return *this;
+}
+
+/**
+ * Limit requests of every client address to the route with a bucket of its own,
+ * on top of the limit of every request. Any method of the url counts.
+ * @param url   Route url, static text with ':param' segments and '*tail'.
+ * @param rate  Requests per second.
+ * @param burst Requests allowed at once after being idle.
+ * @return      self.
+ */
+CoreServer &CoreServer::rateLimit(const std::string &url, const unsigned int rate, const unsigned int burst) {
+	if (!this -> rate_limit) {
+		this -> rate_limit = std::make_unique<CoreRateLimit>();
+	}
+
+	this -> rate_limit -> limit(url, rate, burst);
+	return *this;
+}
+
+/**
+ * Run handlers on a pool of threads instead of the reactor threads.
+ * @param threads Number of handler threads, 0 disables the pool.
+ * @param queue   Requests waiting for a handler thread before new ones get 503.
+ * @return        self.
+ */
+CoreServer &CoreServer::pool(const unsigned int threads, const size_t queue) {
+	this -> options.pool_threads = threads;
+	this -> options.pool_queue   = queue;
+	return *this;
+}
+
+/**
+ * Measure requests per route and expose metrics in Prometheus text format.
+ * @param url Metrics url, empty to measure without exposing them.
+ * @return    self.
+ */
+CoreServer &CoreServer::metrics(const std::string &url) {
+	this -> router.measure(std::make_unique<CoreMetrics>());
+
+	if (!url.empty()) {
+		CoreMetrics *metrics = this -> router.getMetrics();
+
+		router.route("GET", url, [metrics](const Request&, Response &response) {
+			response.type("text/plain; version=0.0.4").send(metrics -> render());
+		});
+	}
+
+	return *this;
+}
+
+/**
+ * Limit request sizes, larger requests are answered with 431 or 413.
+ * @param header    Largest request line and headers.
+ * @param body      Largest request body.
+ * @param spill     Bodies larger than this are written to a temporary file.
+ * @param directory Directory for temporary body files.
+ * @return          self.
+ */
+CoreServer &CoreServer::limits(const size_t header, const size_t body, const size_t spill, const std::string &directory) {
+	this -> options.max_header_size = header;
+	this -> options.max_body_size   = body;
+	this -> options.body_spill_size = spill;
+	this -> options.body_directory  = directory;
+	return *this;
+}
+
+/**
+ * Time in-flight requests get to finish after stop, connections still open after it are closed.
+ * @param timeout Seconds.
+ * @return        self.
+ */
+CoreServer &CoreServer::shutdown(const unsigned int timeout) {
+	this -> options.shutdown_timeout = timeout;
+	return *this;
+}
+
+/**
+ * Serve connections with io_uring: multishot accept and receive into provided buffers,
+ * output of each loop iteration submitted at once and closes linked to the last send.
+ * Falls back to epoll on kernels before 6.0 or with io_uring disabled.
+ * @param enabled Wether to use io_uring.
+ * @return        self.
+ */
+CoreServer &CoreServer::uring(const bool enabled) {
+	this -> options.io_uring = enabled;
+	return *this;
+}
+
+/**
+ * Serve HTTP/2 without TLS next to HTTP/1.1, to clients starting with the
+ * HTTP/2 preface and to requests upgrading with h2c. Streams of a connection
+ * are routed like separate requests, on the pool when there is one.
+ * @param enabled Wether to accept HTTP/2.
+ * @return        self.
+ */
+CoreServer &CoreServer::http2(const bool enabled) {
+	this -> options.http2 = enabled;
+	return *this;
+}
+
+/**
+ * Hand listeners over to the next process for restarts without downtime. On start the
+ * server takes over listeners of the process serving path, that process drains and exits.
+ * Then it serves path itself for the process after it.
+ * @param path Unix socket path.
+ * @return     self.
+ */
+CoreServer &CoreServer::handoff(const std::string &path) {
+	this -> handoff_path = path;
+	return *this;
+}
+
+/**
+ * Stop accepting connections, finish in-flight requests and return from start. Safe from any thread.
+ */
+void CoreServer::stop() {
+	uint64_t one = 1;
+	::write(this -> stop_event, &one, sizeof(one));
+}
+
+/**
+ * Stop every running server on SIGTERM and SIGINT, only async-signal-safe calls.
+ * @param number Signal number.
+ */
+void CoreServer::signal(int) {
+	uint64_t one = 1;
+
+	for (auto &event : stop_events) {
+		int fd = event.load() - 1;
+		if (fd != -1) ::write(fd, &one, sizeof(one));
+	}
+}
+
+/**
+ * Create, bind and start listener on the server port.
+ * @return listener socket.
+ */
+int CoreServer::createListener() {
+	int listener;
+	this -> createSocket(listener);
+	this -> configureSocket(listener);
+	this -> bindSocketAddress(listener, this -> address);
+	this -> startListener(listener);
+	return listener;
+}
+
+/**
+ * Receive listeners of the process serving handoff path.
+ * @param path Unix socket path.
+ * @return listeners, empty when no process serves path.
  */
-void CoreServer::post(const std::string &url, void (*route)(const Request&, Response&)) {
-	router.route("POST", url, route);
+std::vector<int> CoreServer::inherit(const std::string &path) {
+	std::vector<int> listeners;
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (path.length() >= sizeof(address.sun_path)) return listeners;
+	memcpy(address.sun_path, path.c_str(), path.length());
+
+	int connection = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (connection == -1) return listeners;
+
+	// No previous process, listeners are created.
+	if (connect(connection, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1) {
+		::close(connection);
+		return listeners;
+	}
+
+	char byte;
+	iovec part = {&byte, 1};
+	alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 64)];
+
+	msghdr message = {};
+	message.msg_iov        = &part;
+	message.msg_iovlen     = 1;
+	message.msg_control    = control;
+	message.msg_controllen = sizeof(control);
+
+	ssize_t size;
+	do {
+		size = recvmsg(connection, &message, MSG_CMSG_CLOEXEC);
+	} while (size == -1 && errno == EINTR);
+
+	for (cmsghdr *header = size > 0 ? CMSG_FIRSTHDR(&message) : nullptr; header; header = CMSG_NXTHDR(&message, header)) {
+		if (header -> cmsg_level != SOL_SOCKET || header -> cmsg_type != SCM_RIGHTS) continue;
+
+		size_t count = (header -> cmsg_len - CMSG_LEN(0)) / sizeof(int);
+		const int *fds = reinterpret_cast<const int*>(CMSG_DATA(header));
+		listeners.assign(fds, fds + count);
+	}
+
+	::close(connection);
+	return listeners;
+}
+
+/**
+ * Serve handoff path until the next process takes the listeners or server stops.
+ * Listeners are sent over SCM_RIGHTS and this server starts draining.
+ */
+void CoreServer::serveHandoff() {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	memcpy(address.sun_path, this -> handoff_path.c_str(), std::min(this -> handoff_path.length(), sizeof(address.sun_path) - 1));
+
+	int handoff = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	unlink(address.sun_path);
+
+	if (handoff == -1 || bind(handoff, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 || ::listen(handoff, 1) == -1) {
+		perror("Unable to serve listener handoff: ");
+		if (handoff != -1) ::close(handoff);
+		return;
+	}
+
+	bool handed = false;
+
+	while (!handed) {
+		pollfd events[2] = {{handoff, POLLIN, 0}, {this -> stop_event, POLLIN, 0}};
+		if (::poll(events, 2, -1) == -1 && errno != EINTR) break;
+		if (events[1].revents & POLLIN) break;
+		if (!(events[0].revents & POLLIN)) continue;
+
+		int connection = accept4(handoff, nullptr, nullptr, SOCK_CLOEXEC);
+		if (connection == -1) continue;
+
+		char byte = 0;
+		iovec part = {&byte, 1};
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * 64)] = {};
+		size_t count = std::min<size_t>(this -> listeners.size(), 64);
+
+		msghdr message = {};
+		message.msg_iov        = &part;
+		message.msg_iovlen     = 1;
+		message.msg_control    = control;
+		message.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+
+		cmsghdr *header = CMSG_FIRSTHDR(&message);
+		header -> cmsg_level = SOL_SOCKET;
+		header -> cmsg_type  = SCM_RIGHTS;
+		header -> cmsg_len   = CMSG_LEN(sizeof(int) * count);
+		memcpy(CMSG_DATA(header), this -> listeners.data(), sizeof(int) * count);
+
+		handed = sendmsg(connection, &message, MSG_NOSIGNAL) == 1;
+		::close(connection);
+	}
+
+	::close(handoff);
+
+	// Next process owns the path now, it is only removed when nobody took over.
+	if (handed) {
+		std::cout << "Listeners handed over, draining." << std::endl;
+		this -> stop();
+	} else {
+		unlink(address.sun_path);
+	}
 }
 
 /**
@@ -77,6 +527,7 @@ void CoreServer::configureSocket(int &server) {
 	if (
 		setsockopt(server, SOL_TCP,    TCP_NODELAY,  &conf, sizeof(conf)) == -1 ||
 		setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &conf, sizeof(conf)) == -1 ||
+		setsockopt(server, SOL_SOCKET, SO_REUSEPORT, &conf, sizeof(conf)) == -1 ||
 		setsockopt(server, SOL_SOCKET, SO_KEEPALIVE, &conf, sizeof(conf)) == -1
 	) {
 		perror("Unable to configure server: ");
@@ -119,28 +570,116 @@ void CoreServer::startListener(int &server) {
 	}
 }
 
+/**
+ * Pin the calling worker thread to its own core.
+ * @param worker Worker index.
+ */
+void CoreServer::pinWorker(const unsigned int worker) {
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (cores == 0) return;
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(worker % cores, &set);
+
+	if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+		std::cerr << "Unable to pin worker " << worker << " to core." << std::endl;
+	}
+}
+
+/**
+ * Run worker reactor on its own SO_REUSEPORT listener so kernel balances accepts.
+ * @param worker Worker index.
+ */
+int CoreServer::work(const unsigned int worker) {
+	if (this -> listeners.size() > 1) {
+		this -> pinWorker(worker);
+	}
+
+	CoreReactor reactor(this -> router, this -> listeners[worker], this -> options, this -> handler_pool.get(), this -> stop_event, this -> connection_limits.get(), this -> rate_limit.get());
+	return reactor.run();
+}
+
 /**
  * Start server responder.
  */
 int CoreServer::start() {
-	std::cout << "Server running on port: " << this -> port << std::endl;
+	// Listeners of the previous process keep their accept queues, missing ones are created.
+	std::vector<int> inherited = this -> handoff_path.empty() ? std::vector<int>() : this -> inherit(this -> handoff_path);
+	size_t count = std::max<size_t>(this -> workers, inherited.size());
 
-	// Server main loop.
-	while (true) {
-		// Check for connection.
-		int connection = (accept(server, (struct sockaddr*) &address, (socklen_t*) &address_size));
+	for (size_t worker = 0; worker < count; worker++) {
+		this -> listeners.push_back(worker < inherited.size() ? inherited[worker] : this -> createListener());
+	}
 
-		// Connection found.
-		if (connection != -1) {
-			respond(router, connection);
+	this -> server = this -> listeners[0];
 
-		// Connection not found.
-		} else {
-			perror("Request failed: ");
-			exit(EXIT_FAILURE);
-		}
+	if (this -> options.io_uring && !CoreRing::supported()) {
+		std::cerr << "io_uring is not supported, using epoll." << std::endl;
+		this -> options.io_uring = false;
+	}
+
+	std::cout << "Server running on port: " << this -> port << " with " << count << " worker(s)";
+	if (!inherited.empty()) std::cout << ", " << inherited.size() << " listener(s) inherited";
+	if (this -> options.io_uring) std::cout << " on io_uring";
+	if (this -> options.http2) std::cout << " with h2c";
+	std::cout << std::endl;
+
+	// Drain on SIGTERM and SIGINT.
+	for (auto &event : stop_events) {
+		int free = 0;
+		if (event.compare_exchange_strong(free, this -> stop_event + 1)) break;
+	}
+
+	struct sigaction action = {};
+	action.sa_handler = &CoreServer::signal;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGTERM, &action, nullptr);
+	sigaction(SIGINT,  &action, nullptr);
+
+	// Shared handler pool.
+	if (this -> options.pool_threads > 0) {
+		this -> handler_pool = std::make_unique<CorePool>(this -> options.pool_threads, this -> options.pool_queue);
+	}
+
+	if (this -> router.metrics) {
+		this -> router.metrics -> pool = this -> handler_pool.get();
+	}
+
+	// Connection caps shared by every worker.
+	if (this -> options.max_connections > 0 || this -> options.max_connections_per_address > 0) {
+		this -> connection_limits = std::make_unique<CoreLimits>(this -> options.max_connections, this -> options.max_connections_per_address);
+	}
+
+	// Additional workers, each with own listener and event loop.
+	std::vector<std::thread> threads;
+	for (unsigned int worker = 1; worker < count; worker++) {
+		threads.emplace_back(&CoreServer::work, this, worker);
+	}
+
+	if (!this -> handoff_path.empty()) {
+		threads.emplace_back(&CoreServer::serveHandoff, this);
+	}
+
+	// Server main loop, first worker runs on the calling thread until stopped.
+	int status = this -> work(0);
+
+	// First worker may also return on failure, the others and the handoff listener stop with it.
+	this -> stop();
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+
+	// Queued handlers finish before the pool is gone.
+	this -> handler_pool.reset();
+	this -> connection_limits.reset();
+
+	for (auto &event : stop_events) {
+		int used = this -> stop_event + 1;
+		event.compare_exchange_strong(used, 0);
 	}
 
 	std::cout << "Server closed." << std::endl;
-	return EXIT_FAILURE;
+	return status;
 }
@@ -2,44 +2,104 @@
 #define CORE_SERVER_HPP
 
 #include <core/router/router.hpp>
+#include <core/server/options.hpp>
+#include <core/pool/pool.hpp>
+#include <core/limits/limits.hpp>
+#include <core/limits/rate.hpp>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <cstddef>
 #include <string>
+#include <memory>
+#include <vector>
 
 
 class CoreServer {
 	public:
-		CoreServer(CoreRouter &router, const unsigned int port, const unsigned int connections);
+		CoreServer(CoreRouter &router, const unsigned int port, const unsigned int connections, const unsigned int workers = 1);
+		~CoreServer();
 
 		// Routes.
-		void get(const std::string &url, void (*route)(const Request&, Response&));
+		void get(const std::string &url, CoreRouter::Handler route);
 		void get(const std::string &url, const std::string &content);
-		void post(const std::string &url, void (*route)(const Request&, Response&));
+		void post(const std::string &url, CoreRouter::Handler route);
 		void post(const std::string &url, const std::string &content);
+		void upload(const std::string &url, CoreBody::Consumer consumer, CoreRouter::Handler route);
+		void websocket(const std::string &url, CoreWebSocket::Handlers handlers);
+
+		// Middleware.
+		CoreServer &use(CoreMiddleware::Layer layer);
+
+		// Compression.
+		CoreServer &compress(std::unique_ptr<CoreCompress> compression = std::make_unique<CoreCompress>());
+
+		// Static files.
+		CoreServer &serve(const std::string &url, const std::string &directory, const size_t cache_file = 65536, const size_t cache_size = 67108864);
+
+		// Response cache.
+		CoreServer &cache(std::unique_ptr<CoreCache> cache);
+		CoreServer &cache(const std::string &url, const unsigned int ttl, const std::vector<std::string> &query = {}, const std::vector<std::string> &headers = {});
+
+		// Metrics.
+		CoreServer &metrics(const std::string &url = "/metrics");
+
+		CoreServer &keepAlive(const unsigned int timeout, const unsigned int requests);
+		CoreServer &timeouts(const unsigned int header, const unsigned int body, const unsigned int write);
+		CoreServer &connectionLimit(const size_t total, const size_t per_address = 0);
+		CoreServer &rateLimit(const unsigned int rate, const unsigned int burst);
+		CoreServer &rateLimit(const std::string &url, const unsigned int rate, const unsigned int burst);
+		CoreServer &pool(const unsigned int threads, const size_t queue);
+		CoreServer &shutdown(const unsigned int timeout);
+		CoreServer &uring(const bool enabled = true);
+		CoreServer &http2(const bool enabled = true);
+		CoreServer &handoff(const std::string &path);
+		CoreServer &limits(const size_t header, const size_t body, const size_t spill, const std::string &directory = "/tmp");
 
 		int start();
+		void stop();
 
 	private:
 		CoreRouter &router;
 
 		const unsigned int port;
 		const unsigned int connections;
+		const unsigned int workers;
+		CoreOptions options;
+		std::unique_ptr<CorePool> handler_pool;
+		std::unique_ptr<CoreLimits> connection_limits;
+		std::unique_ptr<CoreRateLimit> rate_limit;
 
 		const int family   = AF_INET;
 		const int addr     = INADDR_ANY;
 		const int type     = SOCK_STREAM;
 		const int protocol = IPPROTO_IP;
 
-		int          server;
+		int          server = -1;
 		sockaddr_in  address;
 		unsigned int address_size;
 
+		// Listener of every worker, inherited from the previous process or created.
+		std::vector<int> listeners;
+
+		// Stop event watched by every worker, written by stop() and SIGTERM/SIGINT.
+		int stop_event = -1;
+
+		// Unix socket path where the next process takes over the listeners.
+		std::string handoff_path;
+
 		void createSocket      (int &server);
 		void configureSocket   (int &server);
 		void startListener     (int &server);
 		void bindSocketAddress (int &server, sockaddr_in &server_address);
 		void createAddress     (sockaddr_in &address, unsigned int &address_size);
+		int  createListener    ();
+
+		int  work         (const unsigned int worker);
+		void pinWorker    (const unsigned int worker);
+		void serveHandoff ();
+
+		std::vector<int> inherit (const std::string &path);
+		static void      signal  (int number);
 };
 
 #endif
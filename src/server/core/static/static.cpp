@@ -0,0 +1,346 @@
+#include <core/static/static.hpp>
+#include <core/compress/compress.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <charconv>
+#include <cstdio>
+
+/**
+ * Mount directory of static files.
+ * @param directory  Directory to serve files from.
+ * @param cache_file Largest file size kept in memory, larger files use sendfile.
+ * @param cache_size Memory limit of all cached files.
+ */
+CoreStatic::CoreStatic(const std::string &directory, const size_t cache_file, const size_t cache_size):
+	directory(directory), cache_file(cache_file), cache_size(cache_size) {
+}
+
+/**
+ * Unmap cached file.
+ */
+CoreStatic::Mapping::~Mapping() {
+	if (this -> data) {
+		munmap(this -> data, this -> size);
+	}
+}
+
+/**
+ * Serve file from route tail param "path". Response is not sent when the
+ * file does not exist so router answers with 404.
+ * @param request  Request with "path" param.
+ * @param response Response to send file with.
+ */
+void CoreStatic::serve(const Request &request, Response &response) {
+	std::string path = this -> resolve(request.getParam("path"));
+	if (path.empty()) return;
+
+	struct stat info;
+	int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+
+	// Directories serve their index file.
+	if (file != -1 && fstat(file, &info) == 0 && S_ISDIR(info.st_mode)) {
+		close(file);
+		path += "/index.html";
+		file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	}
+
+	if (file == -1) return;
+	if (fstat(file, &info) == -1 || !S_ISREG(info.st_mode)) {
+		close(file);
+		return;
+	}
+
+	std::string tag      = etag(info);
+	std::string modified = date(info.st_mtime);
+	response.header("Last-Modified", modified).header("Accept-Ranges", "bytes");
+
+	// Conditional GET, If-None-Match wins over If-Modified-Since.
+	std::string_view none_match = request.getHeader("If-None-Match");
+	std::string_view since      = request.getHeader("If-Modified-Since");
+	time_t since_time           = since.empty() ? -1 : parseDate(since);
+
+	if (!none_match.empty() ? matchesTag(none_match, tag) : since_time != -1 && since_time >= info.st_mtime) {
+		response.header("ETag", tag).status(304).send();
+		close(file);
+		return;
+	}
+
+	// Range only applies while If-Range still matches the file.
+	size_t size   = info.st_size;
+	size_t start  = 0;
+	size_t length = size;
+	bool ranged   = false;
+
+	std::string_view range    = request.getHeader("Range");
+	std::string_view if_range = request.getHeader("If-Range");
+
+	if (!range.empty() && (if_range.empty() || if_range == tag || if_range == modified)) {
+		int found = readRange(range, size, start, length);
+
+		if (found == -1) {
+			response.status(416).header("Content-Range", "bytes */" + std::to_string(size)).send("");
+			close(file);
+			return;
+		}
+
+		if (found == 1) {
+			ranged = true;
+			response.status(206).header("Content-Range", "bytes " + std::to_string(start) + "-" + std::to_string(start + length - 1) + "/" + std::to_string(size));
+		}
+	}
+
+	std::string_view type = mime(path);
+	response.type(std::string(type));
+	response.charset = type.starts_with("text/") || type == "application/javascript" || type == "application/json" ? "utf-8" : "";
+
+	// Small files from memory, compressed copies are cached by path and tag.
+	std::shared_ptr<Mapping> mapping;
+	if (size <= this -> cache_file && (mapping = this -> map(path, file, info))) {
+		response.header("ETag", tag).cache(path + tag);
+		response.sendView(std::string_view(static_cast<const char*>(mapping -> data) + start, length));
+		close(file);
+		return;
+	}
+
+	// Large files with sendfile, from a precompressed ".gz" sibling when accepted and no range applies.
+	// A range covering the whole file is still answered with 206 and identity Content-Range.
+	struct stat compressed_info;
+	int compressed = -1;
+
+	if (!ranged && CoreCompress::accepts(request.getHeader("Accept-Encoding"), "gzip")) {
+		compressed = open((path + ".gz").c_str(), O_RDONLY | O_CLOEXEC);
+
+		if (compressed != -1 && (fstat(compressed, &compressed_info) == -1 || !S_ISREG(compressed_info.st_mode) || compressed_info.st_mtime < info.st_mtime)) {
+			close(compressed);
+			compressed = -1;
+		}
+	}
+
+	if (compressed != -1) {
+		response.header("ETag", "W/" + tag).header("Content-Encoding", "gzip").header("Vary", "Accept-Encoding");
+		response.sendFile(compressed, 0, compressed_info.st_size);
+		close(compressed);
+	} else {
+		response.header("ETag", tag);
+		response.sendFile(file, start, length);
+	}
+
+	close(file);
+}
+
+/**
+ * Get cached file mapping, mapping it on first use or when the file changed.
+ * @param path File path used as cache key.
+ * @param file Open file.
+ * @param info File status.
+ * @return mapping or nullptr when file could not be mapped.
+ */
+std::shared_ptr<CoreStatic::Mapping> CoreStatic::map(const std::string &path, const int file, const struct stat &info) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+
+	auto found = this -> cache.find(path);
+	if (found != this -> cache.end()) {
+		Entry &entry = found -> second;
+
+		// Still fresh, mark as most recently used.
+		if (entry.mapping -> modified == info.st_mtime && entry.mapping -> size == static_cast<size_t>(info.st_size)) {
+			this -> used.splice(this -> used.begin(), this -> used, entry.used);
+			return entry.mapping;
+		}
+
+		this -> cached -= entry.mapping -> size;
+		this -> used.erase(entry.used);
+		this -> cache.erase(found);
+	}
+
+	auto mapping = std::make_shared<Mapping>();
+	mapping -> modified = info.st_mtime;
+	mapping -> size     = info.st_size;
+
+	if (mapping -> size > 0) {
+		void *data = mmap(nullptr, mapping -> size, PROT_READ, MAP_PRIVATE, file, 0);
+		if (data == MAP_FAILED) return nullptr;
+		mapping -> data = data;
+	}
+
+	this -> used.push_front(path);
+	this -> cache[path] = {mapping, this -> used.begin()};
+	this -> cached += mapping -> size;
+
+	// Evict least recently used files over the memory limit.
+	while (this -> cached > this -> cache_size && this -> used.size() > 1) {
+		auto evicted = this -> cache.find(this -> used.back());
+		this -> cached -= evicted -> second.mapping -> size;
+		this -> cache.erase(evicted);
+		this -> used.pop_back();
+	}
+
+	return mapping;
+}
+
+/**
+ * Resolve request path to file path inside the directory.
+ * @param path Percent-encoded path relative to the mount.
+ * @return file path or empty string when path leaves the directory.
+ */
+std::string CoreStatic::resolve(std::string_view path) const {
+	std::string file = this -> directory;
+	std::string segment;
+
+	for (size_t i = 0; i <= path.length(); i++) {
+		// Segment complete.
+		if (i == path.length() || path[i] == '/') {
+			if (segment == "..") return "";
+			if (!segment.empty() && segment != ".") file.append("/").append(segment);
+			segment.clear();
+			continue;
+		}
+
+		char symbol = path[i];
+
+		// Percent-encoded symbol.
+		if (symbol == '%' && i + 2 < path.length()) {
+			unsigned int value = 0;
+			if (std::from_chars(path.data() + i + 1, path.data() + i + 3, value, 16).ptr != path.data() + i + 3) return "";
+			symbol = static_cast<char>(value);
+			i += 2;
+		}
+
+		if (symbol == '\0' || symbol == '/') return "";
+		segment += symbol;
+	}
+
+	return file;
+}
+
+/**
+ * Get content type from file extension.
+ * @param path File path.
+ * @return content type.
+ */
+std::string_view CoreStatic::mime(std::string_view path) {
+	static const std::unordered_map<std::string_view, std::string_view> types = {
+		{"html", "text/html"},       {"htm", "text/html"},          {"css", "text/css"},
+		{"js", "application/javascript"}, {"mjs", "application/javascript"},
+		{"json", "application/json"}, {"map", "application/json"},  {"txt", "text/plain"},
+		{"xml", "text/xml"},         {"csv", "text/csv"},           {"svg", "image/svg+xml"},
+		{"png", "image/png"},        {"jpg", "image/jpeg"},         {"jpeg", "image/jpeg"},
+		{"gif", "image/gif"},        {"webp", "image/webp"},        {"ico", "image/x-icon"},
+		{"avif", "image/avif"},      {"woff", "font/woff"},         {"woff2", "font/woff2"},
+		{"ttf", "font/ttf"},         {"otf", "font/otf"},           {"pdf", "application/pdf"},
+		{"wasm", "application/wasm"}, {"mp4", "video/mp4"},         {"webm", "video/webm"},
+		{"mp3", "audio/mpeg"},       {"zip", "application/zip"},    {"gz", "application/gzip"}
+	};
+
+	size_t dot   = path.rfind('.');
+	size_t slash = path.rfind('/');
+
+	if (dot != std::string_view::npos && (slash == std::string_view::npos || dot > slash)) {
+		auto found = types.find(path.substr(dot + 1));
+		if (found != types.end()) return found -> second;
+	}
+
+	return "application/octet-stream";
+}
+
+/**
+ * Get strong entity tag from file modification time and size.
+ * @param info File status.
+ * @return quoted entity tag.
+ */
+std::string CoreStatic::etag(const struct stat &info) {
+	char tag[48];
+	snprintf(tag, sizeof(tag), "\"%lx-%lx\"", static_cast<unsigned long>(info.st_mtime), static_cast<unsigned long>(info.st_size));
+	return tag;
+}
+
+/**
+ * Format time as HTTP date.
+ * @param time Unix time.
+ * @return date, for example "Sun, 06 Nov 1994 08:49:37 GMT".
+ */
+std::string CoreStatic::date(const time_t time) {
+	char date[32];
+	struct tm utc;
+	gmtime_r(&time, &utc);
+
+	return std::string(date, strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc));
+}
+
+/**
+ * Parse HTTP date.
+ * @param date HTTP date.
+ * @return unix time or -1 when date is invalid.
+ */
+time_t CoreStatic::parseDate(std::string_view date) {
+	struct tm utc = {};
+	std::string text(date);
+
+	if (!strptime(text.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &utc)) return -1;
+	return timegm(&utc);
+}
+
+/**
+ * Check wether If-None-Match header contains entity tag, weak tags compare equal.
+ * @param header Comma separated entity tags or '*'.
+ * @param tag    Current entity tag.
+ * @return true when tag matches.
+ */
+bool CoreStatic::matchesTag(std::string_view header, std::string_view tag) {
+	while (!header.empty()) {
+		size_t comma = header.find(',');
+		std::string_view candidate = header.substr(0, comma);
+		header = comma == std::string_view::npos ? std::string_view() : header.substr(comma + 1);
+
+		while (!candidate.empty() && candidate.front() == ' ') candidate.remove_prefix(1);
+		while (!candidate.empty() && candidate.back()  == ' ') candidate.remove_suffix(1);
+		if (candidate.starts_with("W/")) candidate.remove_prefix(2);
+
+		if (candidate == "*" || candidate == tag) return true;
+	}
+
+	return false;
+}
+
+/**
+ * Read single byte range, multiple ranges are served as the whole file.
+ * @param header Range header, for example "bytes=0-99", "bytes=100-" or "bytes=-100".
+ * @param size   File size.
+ * @param start  Range start.
+ * @param length Range length.
+ * @return 1 for range, 0 when range is ignored and -1 when range is not satisfiable.
+ */
+int CoreStatic::readRange(std::string_view header, const size_t size, size_t &start, size_t &length) {
+	if (!header.starts_with("bytes=") || header.find(',') != std::string_view::npos) return 0;
+	header.remove_prefix(6);
+
+	size_t dash = header.find('-');
+	if (dash == std::string_view::npos) return 0;
+
+	std::string_view first = header.substr(0, dash);
+	std::string_view last  = header.substr(dash + 1);
+	size_t from = 0, to = 0;
+
+	if (!first.empty() && std::from_chars(first.data(), first.data() + first.length(), from).ptr != first.data() + first.length()) return 0;
+	if (!last.empty()  && std::from_chars(last.data(),  last.data()  + last.length(),  to).ptr   != last.data()  + last.length())  return 0;
+
+	// Suffix range, last bytes of the file.
+	if (first.empty()) {
+		if (last.empty()) return 0;
+		if (to == 0 || size == 0) return -1;
+
+		start  = size - std::min(to, size);
+		length = size - start;
+		return 1;
+	}
+
+	if (from >= size) return -1;
+	if (!last.empty() && to < from) return 0;
+
+	start  = from;
+	length = (last.empty() ? size - 1 : std::min(to, size - 1)) - from + 1;
+	return 1;
+}
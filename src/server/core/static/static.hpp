@@ -0,0 +1,60 @@
+#ifndef CORE_STATIC_HPP
+#define CORE_STATIC_HPP
+
+#include <core/headers/request.hpp>
+#include <core/headers/response.hpp>
+
+#include <sys/stat.h>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/**
+ * Static files of one directory. Small files are served from an mmap'd
+ * LRU cache, large files with sendfile. Supports conditional and range requests.
+ */
+class CoreStatic {
+	public:
+		CoreStatic(const std::string &directory, const size_t cache_file = 65536, const size_t cache_size = 67108864);
+
+		void serve(const Request &request, Response &response);
+
+	private:
+		// Memory mapped file, unmapped when the last response using it is done.
+		struct Mapping {
+			void *data    = nullptr;
+			size_t size   = 0;
+			time_t modified = 0;
+			~Mapping();
+		};
+
+		struct Entry {
+			std::shared_ptr<Mapping> mapping;
+			std::list<std::string>::iterator used;
+		};
+
+		const std::string directory;
+		const size_t cache_file;
+		const size_t cache_size;
+
+		std::mutex mutex;
+		std::list<std::string> used;
+		std::unordered_map<std::string, Entry> cache;
+		size_t cached = 0;
+
+		std::shared_ptr<Mapping> map(const std::string &path, const int file, const struct stat &info);
+		std::string resolve(std::string_view path) const;
+
+		static std::string_view mime(std::string_view path);
+		static std::string etag(const struct stat &info);
+		static std::string date(const time_t time);
+		static time_t parseDate(std::string_view date);
+		static bool matchesTag(std::string_view header, std::string_view tag);
+		static int readRange(std::string_view header, const size_t size, size_t &start, size_t &length);
+};
+
+#endif
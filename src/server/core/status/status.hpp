@@ -2,6 +2,8 @@
 #define CORE_STATUS_HPP
 
 #include <string>
+#include <string_view>
+#include <vector>
 #include <map>
 
 /**
@@ -89,6 +91,29 @@ namespace Status {
 	static std::string& get(const unsigned int code) {
 		return status.at(code);
 	}
+
+	/**
+	 * Get preformatted HTTP/1.1 status line, built once from status messages.
+	 * @param code HTTP status code.
+	 * @return status line with trailing CRLF.
+	 */
+	static std::string_view line(const unsigned int code) {
+		static const std::vector<std::string> lines = [] {
+			std::vector<std::string> lines(600);
+
+			for (const auto &[code, message] : status) {
+				lines[code] = "HTTP/1.1 " + std::to_string(code) + " " + message + "\r\n";
+			}
+
+			return lines;
+		}();
+
+		if (code >= lines.size() || lines[code].empty()) {
+			return get(code);
+		}
+
+		return lines[code];
+	}
 };
 
 #endif
@@ -0,0 +1,191 @@
+#include <core/stream/stream.hpp>
+
+#include <charconv>
+#include <errno.h>
+#include <sys/socket.h>
+
+/**
+ * Response stream of connection, headers are already sent.
+ * @param connection Client connection.
+ * @param chunked    Wether data is framed with chunked transfer encoding.
+ * @param queued     Wether data goes to the reactor instead of the socket.
+ */
+CoreStream::CoreStream(const int connection, const bool chunked, const bool queued):
+	connection(connection),
+	chunked(chunked),
+	queued(queued) {
+}
+
+/**
+ * Write data as one chunk, empty data writes nothing.
+ * @param data Data to write.
+ * @return false when stream is ended or client is gone.
+ */
+bool CoreStream::write(std::string_view data) {
+	return this -> push(data);
+}
+
+/**
+ * Write server-sent event, every line of data becomes its own data field.
+ * @param data Event data.
+ * @param name Event name, empty for the default message event.
+ * @param id   Event id client sends back as Last-Event-ID, empty to omit.
+ * @return false when stream is ended or client is gone.
+ */
+bool CoreStream::event(std::string_view data, std::string_view name, std::string_view id) {
+	std::string event;
+	event.reserve(data.length() + name.length() + id.length() + 32);
+
+	if (!name.empty()) event.append("event: ").append(name).append("\n");
+	if (!id.empty())   event.append("id: ").append(id).append("\n");
+
+	while (true) {
+		size_t end = data.find('\n');
+		event.append("data: ").append(data.substr(0, end)).append("\n");
+
+		if (end == std::string_view::npos) break;
+		data.remove_prefix(end + 1);
+	}
+
+	event.append("\n");
+	return this -> push(event);
+}
+
+/**
+ * Write server-sent event comment, clients ignore it. Keeps idle streams
+ * alive through proxies and finds clients that are gone.
+ * @param text Comment text.
+ * @return false when stream is ended or client is gone.
+ */
+bool CoreStream::comment(std::string_view text) {
+	std::string comment;
+	comment.append(": ").append(text).append("\n\n");
+	return this -> push(comment);
+}
+
+/**
+ * End the stream, connection continues with the next request or closes.
+ */
+void CoreStream::end() {
+	this -> push(std::string_view(), true);
+}
+
+/**
+ * Check wether stream accepts more data.
+ * @return false when ended or client is gone.
+ */
+bool CoreStream::isOpen() const {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	return !this -> ended && !this -> closed;
+}
+
+/**
+ * Bytes written to a queued stream that did not reach the socket yet, producers
+ * can wait while it grows instead of buffering a slow client's data in memory.
+ * @return pending bytes.
+ */
+size_t CoreStream::pending() const {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	return this -> data.length();
+}
+
+/**
+ * Frame data and queue or send it.
+ * @param data Data to write.
+ * @param last Wether the stream ends after data.
+ * @return false when stream is ended or client is gone.
+ */
+bool CoreStream::push(std::string_view data, const bool last) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	if (this -> ended || this -> closed) return false;
+
+	std::string framed;
+	if (this -> chunked && !data.empty()) {
+		char size[24];
+		framed.reserve(data.length() + 32);
+		framed.append(size, std::to_chars(size, size + sizeof(size), data.length(), 16).ptr);
+		framed.append("\r\n").append(data).append("\r\n");
+		data = framed;
+	}
+
+	this -> ended = last;
+	if (last && this -> chunked) data = "0\r\n\r\n";
+
+	if (!this -> queued) {
+		return this -> send(data);
+	}
+
+	// Reactor is woken once per batch of data, and when stream ends.
+	bool idle = this -> data.empty();
+	this -> data.append(data);
+
+	if (this -> notify && ((idle && !this -> data.empty()) || last)) {
+		this -> notify();
+	}
+
+	return true;
+}
+
+/**
+ * Send data right away on the blocking socket, waiting at most its send timeout when it is full.
+ * @param data Framed data.
+ * @return false when client is gone.
+ */
+bool CoreStream::send(std::string_view data) {
+	while (!data.empty()) {
+		ssize_t size = ::send(this -> connection, data.data(), data.length(), MSG_NOSIGNAL);
+
+		if (size > 0) {
+			data.remove_prefix(size);
+
+		} else if (size == -1 && errno == EINTR) {
+			continue;
+
+		// Client is gone, or stopped reading until the send timeout of the blocking socket ran out.
+		} else {
+			this -> closed = true;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Wake reactor with notify whenever data is queued, including data queued so far.
+ * @param notify Callback that wakes the reactor.
+ */
+void CoreStream::attach(Notify notify) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	this -> notify = std::move(notify);
+
+	if (!this -> data.empty() || this -> ended) {
+		this -> notify();
+	}
+}
+
+/**
+ * Move queued data to the connection output.
+ * @param output Connection output.
+ * @return true when stream ended and all its data was taken.
+ */
+bool CoreStream::take(CoreOutput &output) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+
+	if (!this -> data.empty()) {
+		output.append(this -> data);
+		this -> data.clear();
+	}
+
+	return this -> ended;
+}
+
+/**
+ * Connection is gone, later writes fail and reactor is not woken anymore.
+ */
+void CoreStream::close() {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	this -> closed = true;
+	this -> notify = nullptr;
+	this -> data.clear();
+}
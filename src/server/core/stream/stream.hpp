@@ -0,0 +1,60 @@
+#ifndef CORE_STREAM_HPP
+#define CORE_STREAM_HPP
+
+#include <core/output/output.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+/**
+ * Response body written piece by piece after headers were sent, with chunked
+ * transfer encoding when client supports it. Queued streams hand data to the
+ * reactor and may be written from any thread for as long as the connection
+ * stays open, direct streams write to the socket right away and end with the handler.
+ */
+class CoreStream {
+	public:
+		using Notify = std::function<void()>;
+
+		CoreStream(const int connection, const bool chunked, const bool queued);
+		CoreStream(const CoreStream&) = delete;
+		CoreStream &operator=(const CoreStream&) = delete;
+
+		bool write(std::string_view data);
+		bool event(std::string_view data, std::string_view name = "", std::string_view id = "");
+		bool comment(std::string_view text);
+		void end();
+
+		bool isOpen() const;
+		size_t pending() const;
+
+	private:
+		mutable std::mutex mutex;
+		const int connection;
+		const bool chunked;
+		const bool queued;
+
+		// Queued data not yet taken by the reactor, notify wakes it up.
+		std::string data;
+		Notify notify;
+		bool ended  = false;
+		bool closed = false;
+
+		bool push(std::string_view data, const bool last = false);
+		bool send(std::string_view data);
+
+		// Reactor side of queued streams.
+		void attach(Notify notify);
+		bool take(CoreOutput &output);
+		void close();
+
+	friend class CoreReactor;
+	friend class CoreHttp2;
+	friend class CoreRouter;
+	friend class Response;
+};
+
+#endif
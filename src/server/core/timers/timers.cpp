@@ -0,0 +1,92 @@
+#include <core/timers/timers.hpp>
+
+#include <chrono>
+
+/**
+ * Create wheel starting at the current tick.
+ */
+CoreTimers::CoreTimers():
+	tick(CoreTimers::now()) {
+}
+
+/**
+ * Get current tick of the monotonic clock.
+ */
+uint64_t CoreTimers::now() {
+	auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+	return std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() / tick_ms;
+}
+
+/**
+ * Get tick after milliseconds from now, rounded up.
+ * @param milliseconds Delay.
+ */
+uint64_t CoreTimers::after(const uint64_t milliseconds) {
+	return CoreTimers::now() + (milliseconds + tick_ms - 1) / tick_ms;
+}
+
+/**
+ * Get tick the wheel has advanced to.
+ */
+uint64_t CoreTimers::current() const {
+	return this -> tick;
+}
+
+/**
+ * Schedule timer, deadlines already passed expire on the next advance.
+ * @param key      Timer owner, for example connection.
+ * @param deadline Deadline tick.
+ * @return deadline tick the timer expires at.
+ */
+uint64_t CoreTimers::schedule(const int key, const uint64_t deadline) {
+	uint64_t expires = deadline > this -> tick ? deadline : this -> tick + 1;
+	this -> insert({key, expires});
+	return expires;
+}
+
+/**
+ * Put timer on the level its distance fits, farther than every level goes to the last slot.
+ * @param timer Timer.
+ */
+void CoreTimers::insert(const Timer &timer) {
+	uint64_t distance = timer.second - this -> tick;
+
+	for (size_t level = 0; level < levels; level++) {
+		if (distance < (uint64_t(1) << (level_bits * (level + 1))) || level == levels - 1) {
+			uint64_t deadline = level == levels - 1 && distance >= (uint64_t(1) << (level_bits * levels)) ? this -> tick + (uint64_t(1) << (level_bits * levels)) - 1 : timer.second;
+			this -> wheel[level][(deadline >> (level_bits * level)) & (slots - 1)].push_back(timer);
+			return;
+		}
+	}
+}
+
+/**
+ * Advance wheel to tick, cascading coarse slots when finer levels wrap.
+ * @param now     Tick to advance to.
+ * @param expired Receives expired timers.
+ */
+void CoreTimers::advance(const uint64_t now, std::vector<Timer> &expired) {
+	while (this -> tick < now) {
+		this -> tick++;
+
+		// Finer level wrapped, move next coarse slot down.
+		for (size_t level = 1; level < levels; level++) {
+			if ((this -> tick & ((uint64_t(1) << (level_bits * level)) - 1)) != 0) break;
+
+			std::vector<Timer> cascade;
+			cascade.swap(this -> wheel[level][(this -> tick >> (level_bits * level)) & (slots - 1)]);
+
+			for (const Timer &timer : cascade) {
+				if (timer.second <= this -> tick) {
+					expired.push_back(timer);
+				} else {
+					this -> insert(timer);
+				}
+			}
+		}
+
+		std::vector<Timer> &slot = this -> wheel[0][this -> tick & (slots - 1)];
+		expired.insert(expired.end(), slot.begin(), slot.end());
+		slot.clear();
+	}
+}
@@ -0,0 +1,43 @@
+#ifndef CORE_TIMERS_HPP
+#define CORE_TIMERS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**
+ * Hierarchical timer wheel with 4 levels of 64 slots. Scheduling is O(1),
+ * timers far away sit in coarse levels and cascade to finer ones as time
+ * passes. Timers are not cancelled, owners ignore expired ones that no
+ * longer match their own deadline.
+ */
+class CoreTimers {
+	public:
+		// Timer key and deadline tick.
+		using Timer = std::pair<int, uint64_t>;
+
+		static constexpr uint64_t tick_ms = 10;
+
+		CoreTimers();
+
+		uint64_t schedule(const int key, const uint64_t deadline);
+		void advance(const uint64_t now, std::vector<Timer> &expired);
+		uint64_t current() const;
+
+		static uint64_t now();
+		static uint64_t after(const uint64_t milliseconds);
+
+	private:
+		static constexpr size_t level_bits = 6;
+		static constexpr size_t slots      = 1 << level_bits;
+		static constexpr size_t levels     = 4;
+
+		std::array<std::array<std::vector<Timer>, slots>, levels> wheel;
+		uint64_t tick;
+
+		void insert(const Timer &timer);
+};
+
+#endif
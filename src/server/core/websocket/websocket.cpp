@@ -0,0 +1,591 @@
+#include <core/websocket/websocket.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+ * Rotate 32-bit word left.
+ * @param value Word.
+ * @param bits  Bits to rotate by.
+ */
+static uint32_t rotate(const uint32_t value, const unsigned int bits) {
+	return (value << bits) | (value >> (32 - bits));
+}
+
+/**
+ * Hash input with SHA-1, used only to answer the opening handshake.
+ * @param input  Input.
+ * @param digest Receives the 20 byte digest.
+ */
+static void sha1(std::string_view input, uint8_t digest[20]) {
+	uint32_t state[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+	// Message is padded to whole blocks and ends with its length in bits.
+	std::string message(input);
+	uint64_t bits = uint64_t(input.length()) * 8;
+	message.push_back(static_cast<char>(0x80));
+	while (message.length() % 64 != 56) message.push_back(0);
+	for (int i = 7; i >= 0; i--) message.push_back(static_cast<char>(bits >> (i * 8)));
+
+	for (size_t block = 0; block < message.length(); block += 64) {
+		uint32_t words[80];
+
+		for (size_t i = 0; i < 16; i++) {
+			const uint8_t *bytes = reinterpret_cast<const uint8_t*>(message.data() + block + i * 4);
+			words[i] = uint32_t(bytes[0]) << 24 | uint32_t(bytes[1]) << 16 | uint32_t(bytes[2]) << 8 | bytes[3];
+		}
+
+		for (size_t i = 16; i < 80; i++) {
+			words[i] = rotate(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+		}
+
+		uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+		for (size_t i = 0; i < 80; i++) {
+			uint32_t f, k;
+
+			if (i < 20) {
+				f = (b & c) | (~b & d);
+				k = 0x5a827999;
+			} else if (i < 40) {
+				f = b ^ c ^ d;
+				k = 0x6ed9eba1;
+			} else if (i < 60) {
+				f = (b & c) | (b & d) | (c & d);
+				k = 0x8f1bbcdc;
+			} else {
+				f = b ^ c ^ d;
+				k = 0xca62c1d6;
+			}
+
+			uint32_t next = rotate(a, 5) + f + e + k + words[i];
+			e = d;
+			d = c;
+			c = rotate(b, 30);
+			b = a;
+			a = next;
+		}
+
+		state[0] += a;
+		state[1] += b;
+		state[2] += c;
+		state[3] += d;
+		state[4] += e;
+	}
+
+	for (size_t i = 0; i < 20; i++) {
+		digest[i] = static_cast<uint8_t>(state[i / 4] >> (24 - (i % 4) * 8));
+	}
+}
+
+/**
+ * Append bytes encoded as base64 with padding.
+ * @param text   Receives encoded bytes.
+ * @param bytes  Bytes.
+ * @param length Number of bytes.
+ */
+static void appendBase64(std::string &text, const uint8_t *bytes, const size_t length) {
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	for (size_t i = 0; i < length; i += 3) {
+		uint32_t group = uint32_t(bytes[i]) << 16;
+		if (i + 1 < length) group |= uint32_t(bytes[i + 1]) << 8;
+		if (i + 2 < length) group |= bytes[i + 2];
+
+		text.push_back(alphabet[(group >> 18) & 0x3f]);
+		text.push_back(alphabet[(group >> 12) & 0x3f]);
+		text.push_back(i + 1 < length ? alphabet[(group >> 6) & 0x3f] : '=');
+		text.push_back(i + 2 < length ? alphabet[group & 0x3f] : '=');
+	}
+}
+
+/**
+ * Check wether comma separated header value contains token, case-insensitive.
+ * @param value Header value.
+ * @param token Token.
+ */
+static bool hasToken(std::string_view value, std::string_view token) {
+	while (!value.empty()) {
+		size_t comma = value.find(',');
+		std::string_view part = value.substr(0, comma);
+
+		while (!part.empty() && (part.front() == ' ' || part.front() == '\t')) part.remove_prefix(1);
+		while (!part.empty() && (part.back()  == ' ' || part.back()  == '\t')) part.remove_suffix(1);
+
+		if (boost::algorithm::iequals(part, token)) return true;
+		if (comma == std::string_view::npos) break;
+		value.remove_prefix(comma + 1);
+	}
+
+	return false;
+}
+
+/**
+ * Check wether text is valid UTF-8, ASCII is skipped 8 bytes at a time.
+ * @param text Text.
+ */
+static bool isUtf8(std::string_view text) {
+	const uint8_t *bytes = reinterpret_cast<const uint8_t*>(text.data());
+	size_t length = text.length();
+	size_t i = 0;
+
+	while (i < length) {
+		if (i + 8 <= length) {
+			uint64_t word;
+			std::memcpy(&word, bytes + i, sizeof(word));
+
+			if ((word & 0x8080808080808080ULL) == 0) {
+				i += 8;
+				continue;
+			}
+		}
+
+		uint8_t lead = bytes[i];
+
+		if (lead < 0x80) {
+			i++;
+			continue;
+		}
+
+		size_t extra;
+		uint32_t point, least;
+
+		if ((lead & 0xe0) == 0xc0) {
+			extra = 1, point = lead & 0x1f, least = 0x80;
+		} else if ((lead & 0xf0) == 0xe0) {
+			extra = 2, point = lead & 0x0f, least = 0x800;
+		} else if ((lead & 0xf8) == 0xf0) {
+			extra = 3, point = lead & 0x07, least = 0x10000;
+		} else {
+			return false;
+		}
+
+		if (length - i <= extra) return false;
+
+		for (size_t j = 1; j <= extra; j++) {
+			if ((bytes[i + j] & 0xc0) != 0x80) return false;
+			point = point << 6 | (bytes[i + j] & 0x3f);
+		}
+
+		// Overlong forms, surrogates and code points past Unicode.
+		if (point < least || point > 0x10ffff || (point >= 0xd800 && point <= 0xdfff)) return false;
+		i += extra + 1;
+	}
+
+	return true;
+}
+
+/**
+ * Check wether close code may be sent by a client.
+ * @param code Close code.
+ */
+static bool isCloseCode(const uint16_t code) {
+	return (code >= 1000 && code <= 1003) || (code >= 1007 && code <= 1011) || (code >= 3000 && code <= 4999);
+}
+
+/**
+ * WebSocket of an upgraded connection, the reactor feeds it received bytes.
+ * @param handlers    Handlers of the route, outlive the socket.
+ * @param max_message Largest message accepted, larger ones close with 1009.
+ */
+CoreWebSocket::CoreWebSocket(const Handlers &handlers, const size_t max_message):
+	handlers(handlers),
+	max_message(max_message) {
+}
+
+/**
+ * Send message as one frame.
+ * @param message Message.
+ * @param binary  Wether message is binary instead of UTF-8 text.
+ * @return false when socket is closing or client is gone.
+ */
+bool CoreWebSocket::send(std::string_view message, const bool binary) {
+	return this -> push(frame(binary ? Binary : Text, message));
+}
+
+/**
+ * Send ping, client answers with a pong carrying the same payload.
+ * @param payload Up to 125 bytes.
+ * @return false when payload is too long, socket is closing or client is gone.
+ */
+bool CoreWebSocket::ping(std::string_view payload) {
+	if (payload.length() > control_max) return false;
+	return this -> push(frame(Ping, payload));
+}
+
+/**
+ * Start closing handshake, connection closes once the client answers it.
+ * @param code   Close code.
+ * @param reason Reason, cut to fit a control frame.
+ */
+void CoreWebSocket::close(const uint16_t code, std::string_view reason) {
+	std::string payload;
+	payload.push_back(static_cast<char>(code >> 8));
+	payload.push_back(static_cast<char>(code));
+	payload.append(reason.substr(0, control_max - 2));
+
+	this -> push(frame(Close, payload), true);
+}
+
+/**
+ * Check wether messages can still be sent.
+ * @return false after close or when client is gone.
+ */
+bool CoreWebSocket::isOpen() const {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	return !this -> closing && !this -> closed;
+}
+
+/**
+ * Bytes sent that did not reach the socket yet, senders can wait while it
+ * grows instead of buffering a slow client's messages in memory.
+ * @return pending bytes.
+ */
+size_t CoreWebSocket::pending() const {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	return this -> data.length();
+}
+
+/**
+ * Send message to every open socket, the frame is built once for all of them.
+ * @param sockets Sockets, closed ones are skipped.
+ * @param message Message.
+ * @param binary  Wether message is binary instead of UTF-8 text.
+ * @return number of sockets message was queued to.
+ */
+size_t CoreWebSocket::broadcast(const std::vector<std::shared_ptr<CoreWebSocket>> &sockets, std::string_view message, const bool binary) {
+	std::string framed = frame(binary ? Binary : Text, message);
+	size_t count = 0;
+
+	for (const std::shared_ptr<CoreWebSocket> &socket : sockets) {
+		if (socket && socket -> push(framed)) count++;
+	}
+
+	return count;
+}
+
+/**
+ * Build answer to the opening handshake of a WebSocket version 13 client.
+ * @param request Upgrade request.
+ * @param answer  Receives the 101 response.
+ * @return false when request is not a valid opening handshake.
+ */
+bool CoreWebSocket::handshake(const Request &request, std::string &answer) {
+	static constexpr std::string_view guid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	std::string_view key = request.getHeader("Sec-WebSocket-Key");
+
+	if (request.getMethod() != "GET" || request.getVersion() != "HTTP/1.1" || key.length() != 24) return false;
+	if (request.getHeader("Sec-WebSocket-Version") != "13" || !hasToken(request.getConnection(), "upgrade")) return false;
+
+	uint8_t digest[20];
+	sha1(std::string(key).append(guid), digest);
+
+	answer.append("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ");
+	appendBase64(answer, digest, sizeof(digest));
+	answer.append("\r\n\r\n");
+
+	return true;
+}
+
+/**
+ * Build unmasked server frame.
+ * @param opcode  Opcode.
+ * @param payload Payload.
+ * @return frame.
+ */
+std::string CoreWebSocket::frame(const Opcode opcode, std::string_view payload) {
+	std::string framed;
+	framed.reserve(payload.length() + 10);
+	framed.push_back(static_cast<char>(0x80 | opcode));
+
+	if (payload.length() < 126) {
+		framed.push_back(static_cast<char>(payload.length()));
+	} else if (payload.length() <= 0xffff) {
+		framed.push_back(126);
+		framed.push_back(static_cast<char>(payload.length() >> 8));
+		framed.push_back(static_cast<char>(payload.length()));
+	} else {
+		framed.push_back(127);
+		for (int i = 7; i >= 0; i--) framed.push_back(static_cast<char>(uint64_t(payload.length()) >> (i * 8)));
+	}
+
+	framed.append(payload);
+	return framed;
+}
+
+/**
+ * Unmask payload in place, 16 bytes at a time with SSE2 and 8 bytes at a time
+ * without it.
+ * @param data   Payload part.
+ * @param length Length of the part.
+ * @param key    Masking key of the frame.
+ * @param offset Position of the part in the frame payload.
+ */
+void CoreWebSocket::unmask(char *data, const size_t length, const uint8_t key[4], const size_t offset) {
+	// Key starting at the offset, every 4 bytes use it whole.
+	uint8_t rotated[4];
+	for (size_t i = 0; i < 4; i++) rotated[i] = key[(offset + i) & 3];
+
+	uint32_t word;
+	std::memcpy(&word, rotated, sizeof(word));
+	size_t i = 0;
+
+#if defined(__SSE2__)
+	__m128i mask = _mm_set1_epi32(static_cast<int>(word));
+
+	for (; i + 16 <= length; i += 16) {
+		__m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(block, mask));
+	}
+#endif
+
+	uint64_t wide = uint64_t(word) << 32 | word;
+
+	for (; i + 8 <= length; i += 8) {
+		uint64_t block;
+		std::memcpy(&block, data + i, sizeof(block));
+		block ^= wide;
+		std::memcpy(data + i, &block, sizeof(block));
+	}
+
+	for (; i < length; i++) {
+		data[i] ^= rotated[i & 3];
+	}
+}
+
+/**
+ * Queue frame for the reactor.
+ * @param frame Frame.
+ * @param last  Wether frame is the close frame, nothing is sent after it.
+ * @return false when socket is closing or client is gone.
+ */
+bool CoreWebSocket::push(std::string_view frame, const bool last) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	if (this -> closing || this -> closed) return false;
+
+	// Reactor is woken once per batch of frames.
+	bool idle = this -> data.empty();
+	this -> data.append(frame);
+	this -> closing = last;
+
+	if (this -> notify && idle) {
+		this -> notify();
+	}
+
+	return true;
+}
+
+/**
+ * Run open handler once the handshake answer is queued.
+ * @param request Upgrade request, its route params are set.
+ */
+void CoreWebSocket::open(const Request &request) {
+	if (this -> handlers.open) {
+		this -> handlers.open(this -> shared_from_this(), request);
+	}
+}
+
+/**
+ * Handle received frames, payload of data frames is taken as it arrives so
+ * messages may be larger than the receive buffer.
+ * @param input Received bytes.
+ * @return bytes used, incomplete frame headers are left for later.
+ */
+size_t CoreWebSocket::receive(std::string_view input) {
+	std::shared_ptr<CoreWebSocket> self = this -> shared_from_this();
+	size_t position = 0;
+
+	while (!this -> finished) {
+		if (!this -> framed) {
+			std::string_view view = input.substr(position);
+			if (view.length() < 2) break;
+
+			uint8_t first   = view[0];
+			uint8_t second  = view[1];
+			uint64_t length = second & 0x7f;
+			size_t header   = length == 126 ? 4 : length == 127 ? 10 : 2;
+
+			Opcode received = static_cast<Opcode>(first & 0x0f);
+			bool fin = first & 0x80;
+
+			// Clients mask every frame, no extension was negotiated.
+			if ((first & 0x70) || !(second & 0x80)) {
+				this -> fail(1002);
+				break;
+			}
+
+			// Length and masking key.
+			if (view.length() < header + 4) break;
+
+			if (header > 2) {
+				length = 0;
+				for (size_t i = 2; i < header; i++) length = length << 8 | static_cast<uint8_t>(view[i]);
+			}
+
+			// Control frames are small and may come between fragments.
+			if (received >= Close) {
+				if (!fin || length > control_max || received > Pong) {
+					this -> fail(1002);
+					break;
+				}
+
+				if (view.length() < header + 4 + length) break;
+
+				std::string payload(view.substr(header + 4, length));
+				unmask(payload.data(), payload.length(), reinterpret_cast<const uint8_t*>(view.data() + header), 0);
+
+				position += header + 4 + length;
+				this -> control(received, std::move(payload));
+				continue;
+			}
+
+			// Fragments continue the message a text or binary frame started.
+			if (received > Binary || (received == Continuation) != (this -> opcode != Continuation)) {
+				this -> fail(1002);
+				break;
+			}
+
+			if (length > this -> max_message - this -> message.length()) {
+				this -> fail(1009);
+				break;
+			}
+
+			if (received != Continuation) this -> opcode = received;
+			std::memcpy(this -> key, view.data() + header, sizeof(this -> key));
+
+			this -> final     = fin;
+			this -> remaining = length;
+			this -> unmasked  = 0;
+			this -> framed    = true;
+			position += header + 4;
+		}
+
+		size_t take  = std::min(this -> remaining, input.length() - position);
+		size_t start = this -> message.length();
+
+		this -> message.append(input.substr(position, take));
+		unmask(this -> message.data() + start, take, this -> key, this -> unmasked);
+
+		this -> unmasked  += take;
+		this -> remaining -= take;
+		position += take;
+
+		if (this -> remaining > 0) break;
+
+		this -> framed = false;
+		if (!this -> final) continue;
+
+		bool binary = this -> opcode == Binary;
+		this -> opcode = Continuation;
+
+		if (!binary && !isUtf8(this -> message)) {
+			this -> fail(1007);
+			break;
+		}
+
+		if (this -> handlers.message) {
+			this -> handlers.message(self, this -> message, binary);
+		}
+
+		this -> message.clear();
+	}
+
+	return this -> finished ? input.length() : position;
+}
+
+/**
+ * Answer control frame: pings with pongs, close with close.
+ * @param opcode  Opcode.
+ * @param payload Unmasked payload.
+ */
+void CoreWebSocket::control(const Opcode opcode, std::string payload) {
+	if (opcode == Ping) {
+		this -> push(frame(Pong, payload));
+		return;
+	}
+
+	if (opcode == Pong) return;
+
+	if (payload.length() == 1) {
+		this -> fail(1002);
+		return;
+	}
+
+	uint16_t received = payload.empty() ? 1005 : uint16_t(static_cast<uint8_t>(payload[0])) << 8 | static_cast<uint8_t>(payload[1]);
+
+	if (!payload.empty() && (!isCloseCode(received) || !isUtf8(std::string_view(payload).substr(2)))) {
+		this -> fail(1002);
+		return;
+	}
+
+	// Close is answered with the same code, unless it was sent first.
+	this -> code     = received;
+	this -> finished = true;
+	this -> push(frame(Close, std::string_view(payload).substr(0, payload.empty() ? 0 : 2)), true);
+}
+
+/**
+ * Close after a protocol error, nothing more is received.
+ * @param code Close code.
+ */
+void CoreWebSocket::fail(const uint16_t code) {
+	this -> code     = code;
+	this -> finished = true;
+
+	std::string payload;
+	payload.push_back(static_cast<char>(code >> 8));
+	payload.push_back(static_cast<char>(code));
+	this -> push(frame(Close, payload), true);
+}
+
+/**
+ * Wake reactor with notify whenever frames are queued, including frames queued so far.
+ * @param notify Callback that wakes the reactor.
+ */
+void CoreWebSocket::attach(Notify notify) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+	this -> notify = std::move(notify);
+
+	if (!this -> data.empty()) {
+		this -> notify();
+	}
+}
+
+/**
+ * Move queued frames to the connection output.
+ * @param output Connection output.
+ * @return true when closing handshake finished and connection may close.
+ */
+bool CoreWebSocket::take(CoreOutput &output) {
+	std::lock_guard<std::mutex> lock(this -> mutex);
+
+	if (!this -> data.empty()) {
+		output.append(this -> data);
+		this -> data.clear();
+	}
+
+	return this -> closing && this -> finished;
+}
+
+/**
+ * Connection is gone, later sends fail and the close handler runs.
+ */
+void CoreWebSocket::drop() {
+	{
+		std::lock_guard<std::mutex> lock(this -> mutex);
+		if (this -> closed) return;
+
+		this -> closed = true;
+		this -> notify = nullptr;
+		this -> data.clear();
+	}
+
+	if (this -> handlers.close) {
+		this -> handlers.close(this -> shared_from_this(), this -> code);
+	}
+}
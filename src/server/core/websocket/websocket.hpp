@@ -0,0 +1,97 @@
+#ifndef CORE_WEBSOCKET_HPP
+#define CORE_WEBSOCKET_HPP
+
+#include <core/headers/request.hpp>
+#include <core/output/output.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * WebSocket connection upgraded from an HTTP/1.1 request. Received frames are
+ * unmasked and joined into messages for the handlers of the route, which run
+ * on the reactor thread. Messages may be sent from any thread while it is open.
+ */
+class CoreWebSocket: public std::enable_shared_from_this<CoreWebSocket> {
+	public:
+		using Notify = std::function<void()>;
+
+		// Event handlers of a WebSocket route, handlers left empty are skipped.
+		struct Handlers {
+			std::function<void(const std::shared_ptr<CoreWebSocket>&, const Request&)> open;
+			std::function<void(const std::shared_ptr<CoreWebSocket>&, std::string_view, const bool)> message;
+			std::function<void(const std::shared_ptr<CoreWebSocket>&, const uint16_t)> close;
+		};
+
+		CoreWebSocket(const Handlers &handlers, const size_t max_message);
+		CoreWebSocket(const CoreWebSocket&) = delete;
+		CoreWebSocket &operator=(const CoreWebSocket&) = delete;
+
+		bool send(std::string_view message, const bool binary = false);
+		bool ping(std::string_view payload = std::string_view());
+		void close(const uint16_t code = 1000, std::string_view reason = std::string_view());
+
+		bool isOpen() const;
+		size_t pending() const;
+
+		static size_t broadcast(const std::vector<std::shared_ptr<CoreWebSocket>> &sockets, std::string_view message, const bool binary = false);
+		static bool handshake(const Request &request, std::string &answer);
+
+	private:
+		enum Opcode : uint8_t {
+			Continuation = 0,
+			Text = 1,
+			Binary = 2,
+			Close = 8,
+			Ping = 9,
+			Pong = 10
+		};
+
+		static constexpr size_t control_max = 125;
+
+		const Handlers &handlers;
+		const size_t max_message;
+
+		// Frames not yet taken by the reactor, notify wakes it up.
+		mutable std::mutex mutex;
+		std::string data;
+		Notify notify;
+		bool closing = false;
+		bool closed  = false;
+
+		// Frame being received, its payload arrives in parts.
+		bool framed = false;
+		bool final  = false;
+		uint8_t key[4] = {};
+		size_t remaining = 0;
+		size_t unmasked  = 0;
+
+		// Message joined from fragments, close code received or sent.
+		std::string message;
+		Opcode opcode = Continuation;
+		uint16_t code = 1006;
+		bool finished = false;
+
+		static std::string frame(const Opcode opcode, std::string_view payload);
+		static void unmask(char *data, const size_t length, const uint8_t key[4], const size_t offset);
+		bool push(std::string_view frame, const bool last = false);
+
+		// Reactor side.
+		void open(const Request &request);
+		size_t receive(std::string_view input);
+		void control(const Opcode opcode, std::string payload);
+		void fail(const uint16_t code);
+		void attach(Notify notify);
+		bool take(CoreOutput &output);
+		void drop();
+
+	friend class CoreReactor;
+};
+
+#endif